@@ -1,8 +1,18 @@
 #include "BoxHack.h"
+#include "BoxState.h"
+#include "FactorizationStore.h"
+#include "Instrumentation.h"
+#include "Planner.h"
 #include "SecureBox.h"
+#include "StreamSolver.h"
+#include "ThreadPool.h"
 #include "helpers.h"
+#include <charconv>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <random>
+#include <string>
 
 using namespace SecureBoxHack;
 
@@ -15,30 +25,262 @@ using namespace SecureBoxHack;
 //              operations to make all values in the box 'false'. The function
 //              should return false if the box is successfully unlocked, or
 //              true if any cell remains locked.
+//              The engine selects the Gauss matrix elimination algorithm,
+//              the minimize flag searches for the solution with less toggles.
 //================================================================================
-bool openBox(uint32_t y, uint32_t x)
+bool openBox(uint32_t y,
+             uint32_t x,
+             EliminationEngine engine = EliminationEngine::Naive,
+             bool minimize = false)
 {
     SecureBox box(y, x);
     auto state = box.getState();
 
     helpers::logMatrix(state, "Initial SecureBox state: ");
 
-    auto hack = BoxHack(state);
+    auto hack = BoxHack(state, engine, minimize);
     auto toggleSeq = hack.getUnlockSequence();
 
+    // verify the solution on the packed copy before touching the box
+    BoxState check(state);
+    check.apply(toggleSeq);
+    if (check.isLocked())
+    {
+        helpers::logMessage("The solution doesn't unlock the box");
+        return true;
+    }
+
     for (auto [posY, posX] : toggleSeq)
     {
-        char buffer[100];
-        snprintf(buffer, 100, "Toggle cell in position (%u, %u)", posY, posX);
-        helpers::logMessage(buffer, helpers::LogLevel::DEBUG);
+        helpers::logFormat(helpers::LogLevel::DEBUG,
+                           "Toggle cell in position (%u, %u)",
+                           posY,
+                           posX);
         box.toggle(posY, posX);
     }
 
     return box.isLocked();
 }
 
+//================================================================================
+// Function: precompute
+// Description: Writes the factorizations of the box shapes into the store
+//              directory, so the solvers of the other processes map them
+//              instead of eliminating the toggle matrix again.
+//              The arguments are the directory followed by the pairs of
+//              the box dimensions.
+//================================================================================
+int precompute(int argc, char *argv[])
+{
+    if (argc < 3 || argc % 2 != 1)
+    {
+        std::cout << "Bad usage! The precompute command requires the store "
+                     "directory and the pairs of the box dimensions"
+                  << std::endl;
+        return 1;
+    }
+
+    const std::filesystem::path directory(argv[0]);
+    std::filesystem::create_directories(directory);
+    for (int i = 1; i < argc; i += 2)
+    {
+        uint32_t y = static_cast<uint32_t>(std::atol(argv[i]));
+        uint32_t x = static_cast<uint32_t>(std::atol(argv[i + 1]));
+        if (x == 0 || y == 0)
+            return 1;
+
+        const auto path = directory / store::fileName(y, x);
+        store::save(Factorization(y, x), path);
+        std::cout << "Stored " << path.string() << std::endl;
+    }
+    return 0;
+}
+
+//================================================================================
+// Function: plan
+// Description: Times the elimination engines on the box shapes and saves
+//              the fastest ones into the wisdom file, so the solves with
+//              the auto option dispatch to them at once. The arguments are
+//              the wisdom file, the optional number of the threads prefixed
+//              with "t" (e.g. t8) and the pairs of the box dimensions.
+//              The wisdom is recorded for the host and the threads.
+//================================================================================
+int plan(int argc, char *argv[])
+{
+    const int first = argc > 1 && argv[1][0] == 't' ? 2 : 1;
+    if (argc < first + 2 || (argc - first) % 2 != 0)
+    {
+        std::cout << "Bad usage! The plan command requires the wisdom file "
+                     "and the pairs of the box dimensions"
+                  << std::endl;
+        return 1;
+    }
+    if (first == 2)
+        ThreadPool::configureShared(
+            static_cast<std::size_t>(std::atol(argv[1] + 1)));
+
+    Planner &planner = Planner::shared();
+    planner.setWisdomFile(argv[0]);
+    for (int i = first; i < argc; i += 2)
+    {
+        uint32_t y = static_cast<uint32_t>(std::atol(argv[i]));
+        uint32_t x = static_cast<uint32_t>(std::atol(argv[i + 1]));
+        if (x == 0 || y == 0)
+            return 1;
+
+        const auto result = planner.measure(y, x);
+        std::cout << y << "x" << x << ": "
+                  << Planner::engineName(result.engine) << " "
+                  << result.seconds << " s" << std::endl;
+    }
+    std::cout << "Saved the wisdom of " << Planner::hostKey() << " to "
+              << argv[0] << std::endl;
+    return 0;
+}
+
+//================================================================================
+// Function: solveStream
+// Description: Solves the boxes of the input file or of the standard input
+//              ("-") on the worker threads and prints the results in the
+//              input order, see stream::parseBox() and
+//              stream::formatResult() for the line formats. The optional
+//              arguments are the number of the threads and the number of
+//              the boxes in flight. The throughput and the latencies are
+//              printed to the standard error.
+//================================================================================
+int solveStream(int argc, char *argv[])
+{
+    if (argc < 1)
+    {
+        std::cout << "Bad usage! The stream command requires the input file "
+                     "or '-' for the standard input"
+                  << std::endl;
+        return 1;
+    }
+
+    std::ifstream file;
+    if (std::strcmp(argv[0], "-") != 0)
+    {
+        file.open(argv[0]);
+        if (!file)
+        {
+            std::cerr << "Can't open " << argv[0] << std::endl;
+            return 1;
+        }
+    }
+    std::istream &input = file.is_open() ? file : std::cin;
+
+    const auto threads =
+        static_cast<std::size_t>(argc > 1 ? std::atol(argv[1]) : 0);
+    const auto inFlight = static_cast<std::size_t>(
+        argc > 2 ? std::atol(argv[2]) : 0);
+    stream::StreamSolver solver(
+        threads, inFlight ? inFlight : std::max<std::size_t>(threads, 8) * 16);
+
+    std::ios::sync_with_stdio(false);
+    std::string line;
+    stream::StreamStats stats;
+    try
+    {
+        stats = solver.run(
+            [&]() -> std::optional<stream::BoxInput> {
+                while (std::getline(input, line))
+                    if (auto box = stream::parseBox(line))
+                        return box;
+                return std::nullopt;
+            },
+            [](std::size_t index,
+               bool solvable,
+               const ToggleSequence &toggles) {
+                std::cout << stream::formatResult(index, solvable, toggles)
+                          << '\n';
+            });
+    }
+    catch (const std::exception &e)
+    {
+        std::cout.flush();
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout.flush();
+
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    const double seconds = stats.elapsed.count();
+    std::cerr << "Solved " << stats.boxes << " boxes (" << stats.unsolvable
+              << " locked) in " << seconds << " s, "
+              << (seconds > 0 ? static_cast<double>(stats.boxes) / seconds
+                              : 0.0)
+              << " boxes/s\n"
+              << "Latency ms: p50 " << Milliseconds(stats.p50).count()
+              << ", p90 " << Milliseconds(stats.p90).count() << ", p99 "
+              << Milliseconds(stats.p99).count() << ", max "
+              << Milliseconds(stats.max).count() << std::endl;
+    return 0;
+}
+
+//================================================================================
+// Function: generate
+// Description: Prints the random unlockable boxes in the format of the
+//              stream command. The arguments are the number of the boxes,
+//              the box dimensions and the optional seed.
+//================================================================================
+int generate(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "Bad usage! The generate command requires the number "
+                     "of the boxes and the box dimensions"
+                  << std::endl;
+        return 1;
+    }
+
+    const auto count = std::atol(argv[0]);
+    const auto y = static_cast<uint32_t>(std::atol(argv[1]));
+    const auto x = static_cast<uint32_t>(std::atol(argv[2]));
+    if (x == 0 || y == 0)
+        return 1;
+
+    uint64_t seed = 0;
+    if (argc > 3)
+    {
+        const char *last = argv[3] + std::strlen(argv[3]);
+        const auto [end, error] = std::from_chars(argv[3], last, seed);
+        if (error != std::errc() || end != last)
+        {
+            std::cout << "Bad usage! The seed of the generate command has to "
+                         "be an unsigned integer"
+                      << std::endl;
+            return 1;
+        }
+    }
+    std::mt19937_64 rng(seed);
+
+    std::ios::sync_with_stdio(false);
+    for (long i = 0; i < count; i++)
+    {
+        // the toggles of the unlocked box, so the state can be unlocked
+        BoxState box(y, x);
+        for (std::size_t t = rng() % (std::size_t{y} * x + 1); t > 0; t--)
+            box.toggle(static_cast<uint32_t>(rng() % y),
+                       static_cast<uint32_t>(rng() % x));
+
+        stream::BoxInput input{y, x, helpers::packState(box.getState())};
+        std::cout << stream::formatBox(input) << '\n';
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && std::strcmp(argv[1], "precompute") == 0)
+        return precompute(argc - 2, argv + 2);
+    if (argc > 1 && std::strcmp(argv[1], "plan") == 0)
+        return plan(argc - 2, argv + 2);
+    if (argc > 1 && std::strcmp(argv[1], "stream") == 0)
+        return solveStream(argc - 2, argv + 2);
+    if (argc > 1 && std::strcmp(argv[1], "generate") == 0)
+        return generate(argc - 2, argv + 2);
+
     if (argc < 3)
     {
         std::cout << "Bad usage! The program requires two unsigned integers to "
@@ -53,24 +295,67 @@ int main(int argc, char *argv[])
     if (x == 0 || y == 0)
         return 1;
 
-    if (argc > 3)
+    auto engine = EliminationEngine::Naive;
+    bool minimize = false;
+    // the engine is planned after the threads are configured
+    bool planned = false;
+    // the instrumentation export printed after the solve, if any
+    std::string (*exportStats)(const instrumentation::Snapshot &) = nullptr;
+    for (int i = 3; i < argc; i++)
     {
-        if (std::strcmp(argv[3], "info") == 0)
+        if (std::strcmp(argv[i], "info") == 0)
         {
             helpers::logLevel = helpers::LogLevel::INFO;
         }
-        else if (std::strcmp(argv[3], "debug") == 0)
+        else if (std::strcmp(argv[i], "debug") == 0)
         {
             helpers::logLevel = helpers::LogLevel::DEBUG;
         }
+        else if (std::strcmp(argv[i], "min") == 0)
+        {
+            minimize = true;
+        }
+        else if (std::strcmp(argv[i], "disk") == 0)
+        {
+            engine = EliminationEngine::OutOfCore;
+        }
+        else if (std::strcmp(argv[i], "auto") == 0)
+        {
+            planned = true;
+        }
+        else if (std::strncmp(argv[i], "wisdom=", 7) == 0)
+        {
+            Planner::shared().setWisdomFile(argv[i] + 7);
+            planned = true;
+        }
+        else if (std::strcmp(argv[i], "json") == 0)
+        {
+            exportStats = instrumentation::toJson;
+        }
+        else if (std::strcmp(argv[i], "metrics") == 0)
+        {
+            exportStats = instrumentation::toPrometheus;
+        }
+        else if (auto threads = std::atol(argv[i]); threads > 1)
+        {
+            // more than one thread selects the parallel elimination
+            ThreadPool::configureShared(static_cast<std::size_t>(threads));
+            engine = EliminationEngine::Parallel;
+        }
     }
 
-    bool state = openBox(y, x);
+    if (planned)
+        engine = EliminationEngine::Auto;
+
+    bool state = openBox(y, x, engine, minimize);
 
     if (state)
         std::cout << "BOX: LOCKED!" << std::endl;
     else
         std::cout << "BOX: OPENED!" << std::endl;
 
+    if (exportStats)
+        std::cout << exportStats(instrumentation::snapshot()) << std::endl;
+
     return state;
 }
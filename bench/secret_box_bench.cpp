@@ -0,0 +1,423 @@
+//
+//  secret_box_bench.cpp
+//  SecureBoxTestTask
+//
+//  The phases of the solver timed separately over the box shapes.
+//  The output is JSON unless the other --benchmark_format is passed
+//
+
+#include "Archive.h"
+#include "BoxHack.h"
+#include "BoxState.h"
+#include "FixedShapeHack.h"
+#include "IncrementalHack.h"
+#include "NaiveElimination.h"
+#include "OutOfCoreElimination.h"
+#include "ReusableHack.h"
+#include "Solvability.h"
+#include "StreamSolver.h"
+#include "ThreadPool.h"
+#include "helpers.h"
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+
+using namespace SecureBoxHack;
+
+namespace
+{
+// every shape gets the same states on every run
+constexpr uint32_t seed = 20250107;
+
+struct Shape
+{
+    uint32_t y, x;
+};
+
+// the square and the rectangular boxes up to the largest one solved
+// in about a second by the Four Russians elimination
+const Shape shapes[] = {{4, 4},
+                        {8, 8},
+                        {16, 16},
+                        {32, 32},
+                        {64, 64},
+                        {128, 128},
+                        {4, 16},
+                        {16, 64},
+                        {64, 16},
+                        {32, 128}};
+
+struct Engine
+{
+    const char *name;
+    EliminationEngine engine;
+    // the largest number of the cells timed, the rest are too slow
+    std::size_t maxCells;
+};
+
+const Engine engines[] = {{"Naive", EliminationEngine::Naive, 64 * 64},
+                          {"FourRussians",
+                           EliminationEngine::FourRussians,
+                           128 * 128},
+                          {"Parallel", EliminationEngine::Parallel, 128 * 128},
+                          {"OutOfCore", EliminationEngine::OutOfCore, 64 * 64}};
+
+// a few panels of the OutOfCore engine on the timed shapes instead of
+// the single one
+const elimination::OutOfCoreOptions panels{{}, 1 << 20};
+
+/// @brief The unlockable state of the shape made by the random toggles
+/// of the unlocked box
+struct Input
+{
+    BoolMatrix state;
+    std::vector<uint64_t> packed;
+    ToggleSequence toggles;
+
+    explicit Input(Shape shape) : state(), packed(), toggles()
+    {
+        std::mt19937 rng(seed ^ (shape.y << 16) ^ shape.x);
+        BoxState box(shape.y, shape.x);
+        for (std::size_t i = 0; i < std::size_t{shape.y} * shape.x / 2; i++)
+            box.toggle(static_cast<uint32_t>(rng() % shape.y),
+                       static_cast<uint32_t>(rng() % shape.x));
+        state = box.getState();
+        packed = helpers::packState(state);
+    }
+};
+
+/// @brief Exposes the phases of BoxHack
+class PhaseHack : public BoxHack
+{
+public:
+    using BoxHack::BoxHack;
+    using BoxHack::backSubstitute;
+    using BoxHack::buildGaussMatrix;
+    using BoxHack::echelonGaussMatrix;
+    using BoxHack::fillInitialState;
+};
+
+void setCounters(benchmark::State &state, Shape shape)
+{
+    const auto cells = static_cast<int64_t>(shape.y) * shape.x;
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * cells);
+    state.counters["cells"] = static_cast<double>(cells);
+}
+
+void benchBuildGaussMatrix(benchmark::State &state, Shape shape)
+{
+    const Input input(shape);
+    PhaseHack hack(input.packed, shape.y, shape.x);
+    for (auto _ : state)
+    {
+        hack.buildGaussMatrix();
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, shape);
+}
+
+void benchFillInitialState(benchmark::State &state, Shape shape)
+{
+    const Input input(shape);
+    PhaseHack hack(input.packed, shape.y, shape.x);
+    for (auto _ : state)
+    {
+        hack.fillInitialState(input.packed);
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, shape);
+}
+
+void benchEchelon(benchmark::State &state, Shape shape, Engine engine)
+{
+    const Input input(shape);
+    std::optional<PhaseHack> hack;
+    for (auto _ : state)
+    {
+        // the elimination is destructive, so every iteration gets
+        // the fresh matrix
+        state.PauseTiming();
+        hack.emplace(
+            input.packed, shape.y, shape.x, engine.engine, false, panels);
+        hack->buildGaussMatrix();
+        state.ResumeTiming();
+
+        hack->echelonGaussMatrix();
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, shape);
+}
+
+/// @brief Eliminates the Gauss matrix pivot by pivot with the pivot search
+void benchNaiveSearch(benchmark::State &state,
+                      Shape shape,
+                      elimination::PivotSearch search)
+{
+    const Input input(shape);
+    const std::size_t n = std::size_t{shape.y} * shape.x;
+    GaussMatrix built(n, n + 1);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        helpers::fillToggleRow(built[i], i, shape.y, shape.x);
+        built[i].set(n, input.state[i / shape.x][i % shape.x]);
+    }
+
+    GaussMatrix m(n, n + 1);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        for (std::size_t i = 0; i < n; i++)
+            m[i].assign(built[i]);
+        state.ResumeTiming();
+
+        elimination::echelonNaive(m, search);
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, shape);
+}
+
+void benchBackSubstitute(benchmark::State &state, Shape shape)
+{
+    const Input input(shape);
+    PhaseHack hack(
+        input.packed, shape.y, shape.x, EliminationEngine::FourRussians);
+    hack.buildGaussMatrix();
+    hack.echelonGaussMatrix();
+
+    // the substitution reads the pivot bits of the solution, so the row
+    // is cleared every time, a word per 64 unknowns next to the n^2 / 64
+    // words of the substitution
+    BitMatrix solution(1, std::size_t{shape.y} * shape.x + 1);
+    for (auto _ : state)
+    {
+        solution[0].reset();
+        benchmark::DoNotOptimize(hack.backSubstitute(solution[0]));
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, shape);
+}
+
+void benchApplyToggles(benchmark::State &state, Shape shape)
+{
+    const Input input(shape);
+    const ToggleSequence toggles =
+        BoxHack(input.packed, shape.y, shape.x, EliminationEngine::FourRussians)
+            .getUnlockSequence();
+    BoxState box(input.state);
+    for (auto _ : state)
+    {
+        box.apply(toggles);
+        benchmark::DoNotOptimize(box.isLocked());
+    }
+    setCounters(state, shape);
+    state.counters["toggles"] = static_cast<double>(toggles.size());
+}
+
+void benchUnlockSequence(benchmark::State &state, Shape shape, Engine engine)
+{
+    const Input input(shape);
+    for (auto _ : state)
+    {
+        BoxHack hack(
+            input.packed, shape.y, shape.x, engine.engine, false, panels);
+        benchmark::DoNotOptimize(hack.getUnlockSequence());
+    }
+    setCounters(state, shape);
+}
+
+void benchFixedSolve(benchmark::State &state, Shape shape)
+{
+    const Input input(shape);
+    const auto solver = fixed::findSolver(shape.y, shape.x);
+    fixed::MaxBitset toggles;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(solver(input.packed, toggles));
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, shape);
+}
+
+/// @brief Solves the same shape again and again with the workspace
+/// of the thread
+void benchReusableSolve(benchmark::State &state, Shape shape)
+{
+    const Input input(shape);
+    const ReusableHack solver;
+    ToggleSequence toggles;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(
+            solver.solve(input.packed, shape.y, shape.x, toggles));
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, shape);
+}
+
+/// @brief Flips a cell of the box and rebuilds the toggles of the session
+void benchIncrementalFlip(benchmark::State &state, Shape shape)
+{
+    const Input input(shape);
+    IncrementalHack hack(input.packed, shape.y, shape.x);
+    uint32_t cell = 0;
+    for (auto _ : state)
+    {
+        hack.flip(cell / shape.x % shape.y, cell % shape.x);
+        benchmark::DoNotOptimize(hack.solution().rowData(0));
+        cell += 7;
+    }
+    setCounters(state, shape);
+}
+
+/// @brief Checks the parity invariants of the unlockable state. The shape
+/// is shrunk to the odd one, the even shapes are solvable in O(1)
+void benchSolvability(benchmark::State &state, Shape shape)
+{
+    const Shape odd{shape.y - 1, shape.x - 1};
+    const Input input(odd);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(
+            solvability::isSolvable(input.packed, odd.y, odd.x));
+    setCounters(state, odd);
+}
+
+// the records of the archive and of the text stream read per iteration
+constexpr std::size_t recordCount = 1000;
+
+/// @brief Reads the states from the mapped archive
+void benchArchiveRead(benchmark::State &state, Shape shape)
+{
+    const Input input(shape);
+    const auto path = std::filesystem::temp_directory_path() /
+                      ("secret_box_bench_" + std::to_string(shape.y) + "x" +
+                       std::to_string(shape.x) + ".sba");
+    {
+        archive::Writer writer(path);
+        for (std::size_t i = 0; i < recordCount; i++)
+            writer.add(shape.y, shape.x, input.packed);
+        writer.close();
+    }
+
+    const archive::Reader reader(path);
+    for (auto _ : state)
+    {
+        uint64_t sum = 0;
+        for (const auto &record : reader)
+            for (const uint64_t word : record.state)
+                sum ^= word;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(recordCount));
+    std::filesystem::remove(path);
+}
+
+/// @brief Parses the same states from the lines of the stream command
+void benchTextParse(benchmark::State &state, Shape shape)
+{
+    const Input input(shape);
+    const std::string line =
+        stream::formatBox({shape.y, shape.x, input.packed});
+    const std::vector<std::string> lines(recordCount, line);
+    for (auto _ : state)
+    {
+        uint64_t sum = 0;
+        for (const auto &text : lines)
+        {
+            const auto box = stream::parseBox(text);
+            for (const uint64_t word : box->packed)
+                sum ^= word;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(recordCount));
+}
+
+std::string shapeName(Shape shape)
+{
+    return std::to_string(shape.y) + "x" + std::to_string(shape.x);
+}
+
+void registerBenchmarks()
+{
+    for (const Shape shape : shapes)
+    {
+        const std::string size = std::string("/").append(shapeName(shape));
+        const std::size_t cells = std::size_t{shape.y} * shape.x;
+
+        benchmark::RegisterBenchmark(("BuildGaussMatrix" + size).c_str(),
+                                     benchBuildGaussMatrix,
+                                     shape);
+        benchmark::RegisterBenchmark(("FillInitialState" + size).c_str(),
+                                     benchFillInitialState,
+                                     shape);
+        benchmark::RegisterBenchmark(
+            ("BackSubstitute" + size).c_str(), benchBackSubstitute, shape);
+        benchmark::RegisterBenchmark(
+            ("ApplyToggles" + size).c_str(), benchApplyToggles, shape);
+        benchmark::RegisterBenchmark(
+            ("ArchiveRead" + size).c_str(), benchArchiveRead, shape);
+        benchmark::RegisterBenchmark(
+            ("TextParse" + size).c_str(), benchTextParse, shape);
+        benchmark::RegisterBenchmark(
+            ("ReusableSolve" + size).c_str(), benchReusableSolve, shape);
+        benchmark::RegisterBenchmark(
+            ("IncrementalFlip" + size).c_str(), benchIncrementalFlip, shape);
+        benchmark::RegisterBenchmark(
+            ("Solvability" + size).c_str(), benchSolvability, shape);
+        if (FixedShapeHack::isSpecialized(shape.y, shape.x))
+            benchmark::RegisterBenchmark(
+                ("FixedSolve" + size).c_str(), benchFixedSolve, shape);
+
+        if (cells <= engines[0].maxCells)
+            for (const auto &[name, search] :
+                 {std::pair{"/Rows", elimination::PivotSearch::Rows},
+                  std::pair{"/Columns", elimination::PivotSearch::Columns}})
+                benchmark::RegisterBenchmark(
+                    ("NaiveSearch" + std::string(name) + size).c_str(),
+                    benchNaiveSearch,
+                    shape,
+                    search)
+                    ->Unit(benchmark::kMillisecond);
+
+        for (const Engine engine : engines)
+        {
+            if (cells > engine.maxCells)
+                continue;
+            const std::string name = std::string("/") + engine.name + size;
+            benchmark::RegisterBenchmark(
+                ("Echelon" + name).c_str(), benchEchelon, shape, engine)
+                ->Unit(benchmark::kMillisecond);
+            benchmark::RegisterBenchmark(("UnlockSequence" + name).c_str(),
+                                         benchUnlockSequence,
+                                         shape,
+                                         engine)
+                ->Unit(benchmark::kMillisecond);
+        }
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    // the flags passed later override the JSON format
+    std::string format = "--benchmark_format=json";
+    std::vector<char *> args{argv[0], format.data()};
+    args.insert(args.end(), argv + 1, argv + argc);
+    int count = static_cast<int>(args.size());
+
+    ThreadPool::configureShared(std::thread::hardware_concurrency());
+
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data()))
+        return 1;
+    registerBenchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,386 @@
+#include "Archive.h"
+#include "BitMatrix.h"
+#include "helpers.h"
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SECRET_BOX_MMAP 1
+#endif
+
+namespace SecureBoxHack
+{
+namespace archive
+{
+namespace
+{
+constexpr char magic[8] = {'S', 'B', 'O', 'X', 'A', 'R', 'C', 'H'};
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t wordBytes;
+    uint64_t records;
+    uint64_t reserved;
+};
+static_assert(sizeof(FileHeader) == 32);
+
+struct RecordHeader
+{
+    uint32_t height;
+    uint32_t width;
+    uint8_t solution;
+    uint8_t reserved[3];
+    uint32_t solutionBytes;
+};
+static_assert(sizeof(RecordHeader) == 16);
+
+constexpr std::size_t wordBytes = sizeof(uint64_t);
+
+/// @brief Returns the number of the words of the packed state
+std::size_t stateWords(uint32_t height, uint32_t width)
+{
+    return (std::size_t{height} * width + 63) / 64;
+}
+
+/// @brief Rounds the number of the bytes up to the word
+std::size_t padded(std::size_t bytes)
+{
+    return (bytes + wordBytes - 1) / wordBytes * wordBytes;
+}
+
+/// @brief Appends the LEB128 varint: 7 bits per byte, the high bit
+/// is set on all the bytes but the last one
+void putVarint(std::vector<uint8_t> &out, uint64_t value)
+{
+    for (; value >= 0x80; value >>= 7)
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+/// @brief Encodes the set bits of the bitmap as the differences between
+/// the successive indices. The difference is counted from the index
+/// following the previous one, so the adjacent toggles take 0
+std::vector<uint8_t> encodeDeltas(const std::vector<uint64_t> &bitmap)
+{
+    std::vector<uint8_t> out;
+    std::size_t next = 0;
+    for (std::size_t w = 0; w < bitmap.size(); w++)
+        for (uint64_t word = bitmap[w]; word; word &= word - 1)
+        {
+            const std::size_t k =
+                w * 64 + static_cast<std::size_t>(std::countr_zero(word));
+            putVarint(out, k - next);
+            next = k + 1;
+        }
+    return out;
+}
+} // namespace
+
+ToggleSequence Record::toggles() const
+{
+    const std::size_t cells = std::size_t{height} * width;
+    ToggleSequence toggles;
+    if (solution == Solution::Bitmap)
+    {
+        const std::size_t words = solutionBytes.size() / wordBytes;
+        for (std::size_t w = 0; w < words; w++)
+        {
+            uint64_t word;
+            std::memcpy(&word, solutionBytes.data() + w * wordBytes, wordBytes);
+            // the bits past the cells are zero in the written bitmap
+            if (w + 1 == words && cells % 64 && word >> (cells % 64))
+                throw std::runtime_error("Archive toggle is out of the box");
+            for (; word; word &= word - 1)
+                toggles.push_back(helpers::toCartesianCoordinates(
+                    w * 64 + static_cast<std::size_t>(std::countr_zero(word)),
+                    width));
+        }
+    }
+    else if (solution == Solution::Deltas)
+    {
+        std::size_t next = 0;
+        for (std::size_t b = 0; b < solutionBytes.size();)
+        {
+            uint64_t delta = 0;
+            unsigned shift = 0;
+            uint8_t byte;
+            do
+            {
+                if (b == solutionBytes.size() || shift > 63)
+                    throw std::runtime_error("Archive varint is truncated");
+                byte = solutionBytes[b++];
+                delta |= uint64_t{byte & 0x7fu} << shift;
+                shift += 7;
+            } while (byte & 0x80);
+
+            if (delta >= cells - next)
+                throw std::runtime_error("Archive toggle is out of the box");
+            const std::size_t k = next + delta;
+            toggles.push_back(helpers::toCartesianCoordinates(k, width));
+            next = k + 1;
+        }
+    }
+    return toggles;
+}
+
+Writer::Writer(const std::filesystem::path &path, Encoding solutionEncoding)
+    : destination(path), temporary(path.string() + ".tmp"),
+      encoding(solutionEncoding),
+      file(temporary, std::ios::binary | std::ios::trunc)
+{
+    // the header is rewritten with the number of the records by close()
+    const FileHeader header{};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (!file)
+        throw std::runtime_error("Can't write " + temporary.string());
+}
+
+Writer::~Writer()
+{
+    if (closed)
+        return;
+    file.close();
+    std::error_code ignored;
+    std::filesystem::remove(temporary, ignored);
+}
+
+void Writer::add(uint32_t height,
+                 uint32_t width,
+                 std::span<const uint64_t> packedState)
+{
+    append(height, width, packedState, Solution::None, {});
+}
+
+void Writer::add(uint32_t height,
+                 uint32_t width,
+                 std::span<const uint64_t> packedState,
+                 bool solvable,
+                 const ToggleSequence &toggles)
+{
+    if (!solvable)
+    {
+        append(height, width, packedState, Solution::Locked, {});
+        return;
+    }
+
+    std::vector<uint64_t> bitmap(stateWords(height, width));
+    for (auto [posY, posX] : toggles)
+    {
+        if (posY >= height || posX >= width)
+            throw std::invalid_argument("Toggle is out of the box");
+        const std::size_t k = std::size_t{posY} * width + posX;
+        bitmap[k / 64] ^= uint64_t{1} << (k % 64);
+    }
+
+    const std::size_t bitmapBytes = bitmap.size() * wordBytes;
+    if (encoding != Encoding::Bitmap)
+    {
+        const auto deltas = encodeDeltas(bitmap);
+        if (encoding == Encoding::Deltas || deltas.size() < bitmapBytes)
+        {
+            append(height, width, packedState, Solution::Deltas, deltas);
+            return;
+        }
+    }
+    append(height,
+           width,
+           packedState,
+           Solution::Bitmap,
+           {reinterpret_cast<const uint8_t *>(bitmap.data()), bitmapBytes});
+}
+
+void Writer::append(uint32_t height,
+                    uint32_t width,
+                    std::span<const uint64_t> packedState,
+                    Solution solution,
+                    std::span<const uint8_t> solutionBytes)
+{
+    const std::size_t words = stateWords(height, width);
+    if (!height || !width)
+        throw std::invalid_argument("Archive box shape is empty");
+    if (packedState.size() < words)
+        throw std::invalid_argument("Archive packed state is too short");
+    if (closed)
+        throw std::logic_error("Archive is closed");
+
+    RecordHeader header{};
+    header.height = height;
+    header.width = width;
+    header.solution = static_cast<uint8_t>(solution);
+    header.solutionBytes = static_cast<uint32_t>(solutionBytes.size());
+
+    constexpr char zeros[wordBytes] = {};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(packedState.data()),
+               static_cast<std::streamsize>(words * wordBytes));
+    file.write(reinterpret_cast<const char *>(solutionBytes.data()),
+               static_cast<std::streamsize>(solutionBytes.size()));
+    file.write(zeros,
+               static_cast<std::streamsize>(padded(solutionBytes.size()) -
+                                            solutionBytes.size()));
+    if (!file)
+        throw std::runtime_error("Can't write " + temporary.string());
+    records++;
+}
+
+void Writer::close()
+{
+    if (closed)
+        return;
+
+    FileHeader header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = formatVersion;
+    header.wordBytes = wordBytes;
+    header.records = records;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.close();
+    if (!file)
+        throw std::runtime_error("Can't write " + temporary.string());
+    std::filesystem::rename(temporary, destination);
+    closed = true;
+}
+
+std::size_t Writer::size() const
+{
+    return records;
+}
+
+Reader::Iterator::Iterator(const uint8_t *position, const uint8_t *end)
+    : current(position), next(position), last(end)
+{
+    if (current != last)
+        parse();
+}
+
+Reader::Iterator &Reader::Iterator::operator++()
+{
+    current = next;
+    if (current != last)
+        parse();
+    return *this;
+}
+
+Reader::Iterator Reader::Iterator::operator++(int)
+{
+    Iterator previous = *this;
+    ++*this;
+    return previous;
+}
+
+void Reader::Iterator::parse()
+{
+    const auto left = static_cast<std::size_t>(last - current);
+    if (left < sizeof(RecordHeader))
+        throw std::runtime_error("Archive record is truncated");
+    RecordHeader header;
+    std::memcpy(&header, current, sizeof(header));
+
+    const std::size_t words = stateWords(header.height, header.width);
+    const std::size_t size = sizeof(RecordHeader) + words * wordBytes +
+                             padded(header.solutionBytes);
+    if (size > left)
+        throw std::runtime_error("Archive record is truncated");
+
+    const auto solution = static_cast<Solution>(header.solution);
+    bool valid = header.height && header.width;
+    switch (solution)
+    {
+    case Solution::None:
+    case Solution::Locked:
+        valid = valid && !header.solutionBytes;
+        break;
+    case Solution::Bitmap:
+        valid = valid && header.solutionBytes == words * wordBytes;
+        break;
+    case Solution::Deltas:
+        break;
+    default:
+        valid = false;
+    }
+    if (!valid)
+        throw std::runtime_error("Archive record is corrupted");
+
+    const uint8_t *data = current + sizeof(RecordHeader);
+    record.height = header.height;
+    record.width = header.width;
+    // the records keep the word alignment of the mapping
+    record.state = {reinterpret_cast<const uint64_t *>(data), words};
+    record.solution = solution;
+    record.solutionBytes = {data + words * wordBytes, header.solutionBytes};
+    next = current + size;
+}
+
+Reader::Reader(const std::filesystem::path &path) : storage()
+{
+    const std::size_t fileBytes = std::filesystem::file_size(path);
+    if (fileBytes < sizeof(FileHeader))
+        throw std::runtime_error("Not an archive file");
+
+#if defined(SECRET_BOX_MMAP)
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Can't open " + path.string());
+    void *memory = mmap(nullptr, fileBytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+        throw std::runtime_error("Can't map " + path.string());
+    // the records are read once in order
+    madvise(memory, fileBytes, MADV_SEQUENTIAL);
+    storage = std::shared_ptr<const void>(
+        memory, [fileBytes](const void *mapped) {
+            munmap(const_cast<void *>(mapped), fileBytes);
+        });
+    first = static_cast<const uint8_t *>(memory);
+#else
+    // without the memory mapping the file is read into the aligned storage
+    auto buffer = std::make_shared<BitMatrix>(
+        1, fileBytes * 8 + BitMatrix::alignment * 8);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read(reinterpret_cast<char *>(buffer->rowData(0)),
+                   static_cast<std::streamsize>(fileBytes)))
+        throw std::runtime_error("Can't read " + path.string());
+    first = reinterpret_cast<const uint8_t *>(buffer->rowData(0));
+    storage = std::move(buffer);
+#endif
+    last = first + fileBytes;
+
+    FileHeader header;
+    std::memcpy(&header, first, sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+        throw std::runtime_error("Not an archive file");
+    if (header.version != formatVersion)
+        throw std::runtime_error("Unsupported archive version " +
+                                 std::to_string(header.version));
+    if (header.wordBytes != wordBytes)
+        throw std::runtime_error("Archive layout mismatch");
+    records = header.records;
+    first += sizeof(FileHeader);
+}
+
+std::size_t Reader::size() const
+{
+    return records;
+}
+
+Reader::Iterator Reader::begin() const
+{
+    return {first, last};
+}
+
+Reader::Iterator Reader::end() const
+{
+    return {last, last};
+}
+} // namespace archive
+} // namespace SecureBoxHack
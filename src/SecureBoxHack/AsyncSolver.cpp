@@ -0,0 +1,211 @@
+#include "AsyncSolver.h"
+#include "FixedShapeHack.h"
+#include "helpers.h"
+#include <algorithm>
+#include <memory>
+
+using namespace SecureBoxHack;
+
+bool AsyncSolver::Job::operator<(const Job &other) const
+{
+    // the earlier submission is the greater one within the priority
+    if (priority != other.priority)
+        return priority < other.priority;
+    return sequence > other.sequence;
+}
+
+AsyncSolver::AsyncSolver(std::size_t threads)
+    : workers(), mutex(), wakeUp(), queue(), submitted(0), stopping(false)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; i++)
+        workers.emplace_back(&AsyncSolver::workerLoop, this);
+}
+
+AsyncSolver::~AsyncSolver()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+
+    // nobody takes the queued jobs anymore
+    for (auto &job : queue)
+        job.done({},
+                 std::make_exception_ptr(
+                     SolveStopped(SolveStopped::Reason::Cancelled)));
+}
+
+std::future<SolveResult> AsyncSolver::solveAsync(
+    std::vector<uint64_t> packedState,
+    uint32_t height,
+    uint32_t width,
+    SolveOptions options)
+{
+    // the completion has to be copyable, so the promise is shared
+    auto promise = std::make_shared<std::promise<SolveResult>>();
+    auto future = promise->get_future();
+    submit(std::move(packedState),
+           height,
+           width,
+           std::move(options),
+           [promise](SolveResult result, std::exception_ptr error) {
+               if (error)
+                   promise->set_exception(error);
+               else
+                   promise->set_value(std::move(result));
+           });
+    return future;
+}
+
+std::future<SolveResult> AsyncSolver::solveAsync(const BoolMatrix &state,
+                                                 SolveOptions options)
+{
+    return solveAsync(helpers::packState(state),
+                      static_cast<uint32_t>(state.size()),
+                      static_cast<uint32_t>(helpers::stateWidth(state)),
+                      std::move(options));
+}
+
+AsyncSolver::Awaitable AsyncSolver::solve(std::vector<uint64_t> packedState,
+                                          uint32_t height,
+                                          uint32_t width,
+                                          SolveOptions options)
+{
+    return {*this, std::move(packedState), height, width, std::move(options)};
+}
+
+std::size_t AsyncSolver::size() const
+{
+    return workers.size();
+}
+
+AsyncSolver &AsyncSolver::shared()
+{
+    static AsyncSolver solver;
+    return solver;
+}
+
+void AsyncSolver::submit(std::vector<uint64_t> packedState,
+                         uint32_t height,
+                         uint32_t width,
+                         SolveOptions options,
+                         Completion done)
+{
+    if (packedState.size() * 64 < std::size_t{height} * width)
+        throw std::invalid_argument("AsyncSolver packed state is too short");
+
+    {
+        std::unique_lock lock(mutex);
+        if (stopping)
+        {
+            // e.g. the coroutine resumed by the last running job
+            lock.unlock();
+            done({},
+                 std::make_exception_ptr(
+                     SolveStopped(SolveStopped::Reason::Cancelled)));
+            return;
+        }
+        const Priority priority = options.priority;
+        queue.push_back({priority,
+                         submitted++,
+                         std::move(packedState),
+                         height,
+                         width,
+                         std::move(options),
+                         std::move(done)});
+        std::push_heap(queue.begin(), queue.end());
+    }
+    wakeUp.notify_one();
+}
+
+void AsyncSolver::workerLoop()
+{
+    for (;;)
+    {
+        std::unique_lock lock(mutex);
+        wakeUp.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping)
+            return;
+        std::pop_heap(queue.begin(), queue.end());
+        Job job = std::move(queue.back());
+        queue.pop_back();
+        lock.unlock();
+
+        execute(job);
+    }
+}
+
+void AsyncSolver::execute(Job &job)
+{
+    SolveResult result;
+    std::exception_ptr error;
+    try
+    {
+        const cancellation::StopCondition condition{job.options.token,
+                                                    job.options.deadline};
+        const cancellation::Scope scope(condition);
+        // the job cancelled or expired in the queue isn't started
+        cancellation::checkpoint();
+
+        if (job.options.minimizeToggles)
+        {
+            BoxHack hack(job.packed, job.y, job.x, job.options.engine, true);
+            result.toggles = hack.getUnlockSequence();
+            result.solvable = hack.isSolvable();
+        }
+        else
+        {
+            FixedShapeHack hack(job.packed, job.y, job.x, job.options.engine);
+            result.toggles = hack.getUnlockSequence();
+            result.solvable = hack.isSolvable();
+        }
+        if (!result.solvable)
+            result.toggles.clear();
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    // outside of the scope, the coroutine resumed here may solve more
+    job.done(std::move(result), error);
+}
+
+AsyncSolver::Awaitable::Awaitable(AsyncSolver &executor,
+                                  std::vector<uint64_t> packedState,
+                                  uint32_t height,
+                                  uint32_t width,
+                                  SolveOptions options)
+    : solver(executor), packed(std::move(packedState)), y(height), x(width),
+      solveOptions(std::move(options)), result(), error()
+{
+}
+
+void AsyncSolver::Awaitable::await_suspend(std::coroutine_handle<> handle)
+{
+    // the awaitable lives in the suspended coroutine frame until
+    // the completion resumes it
+    solver.submit(
+        std::move(packed),
+        y,
+        x,
+        std::move(solveOptions),
+        [this, handle](SolveResult solved, std::exception_ptr failed) {
+            result = std::move(solved);
+            error = failed;
+            handle.resume();
+        });
+}
+
+SolveResult AsyncSolver::Awaitable::await_resume()
+{
+    if (error)
+        std::rethrow_exception(error);
+    return std::move(result);
+}
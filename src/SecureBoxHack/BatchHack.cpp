@@ -0,0 +1,83 @@
+#include "BatchHack.h"
+#include "FourRussians.h"
+#include "helpers.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+using namespace SecureBoxHack;
+
+BatchHack::BatchHack(std::vector<BoolMatrix> initialStates)
+    : states(std::move(initialStates)),
+      y(states.empty() ? 0 : states[0].size()),
+      x(states.empty() ? 0 : helpers::stateWidth(states[0])),
+      solvable(states.size(), false)
+{
+    for (const auto &state : states)
+        if (state.size() != y ||
+            std::ranges::any_of(state, [this](const auto &row) {
+                return row.size() != x;
+            }))
+            throw std::invalid_argument("BatchHack states shape mismatch");
+}
+
+bool BatchHack::isSolvable(std::size_t i) const
+{
+    return solvable[i];
+}
+
+std::vector<ToggleSequence> BatchHack::getUnlockSequences()
+{
+    std::vector<ToggleSequence> sequences(states.size());
+    for (std::size_t first = 0; first < states.size(); first += batchWidth)
+        solvePass(first,
+                  std::min(batchWidth, states.size() - first),
+                  sequences);
+
+    helpers::logFormat(
+        helpers::LogLevel::INFO,
+        "Batch solved. %zu of %zu states can be unlocked",
+        static_cast<std::size_t>(std::ranges::count(solvable, true)),
+        states.size());
+
+    return sequences;
+}
+
+void BatchHack::solvePass(std::size_t first,
+                          std::size_t count,
+                          std::vector<ToggleSequence> &sequences)
+{
+    const std::size_t n = y * x;
+    GaussMatrix m(n, n + count, true);
+    for (std::size_t i = 0; i < n; i++)
+        helpers::fillToggleRow(m[i], i, y, x);
+    for (std::size_t b = 0; b < count; b++)
+    {
+        const auto &state = states[first + b];
+        for (std::size_t i = 0; i < y; i++)
+            for (std::size_t j = 0; j < x; j++)
+                if (state[i][j])
+                    m[i * x + j].set(n + b);
+    }
+
+    const auto pivotCols = elimination::reduceFourRussians(m, n, true);
+
+    // every box is solvable unless some row without the pivot is left
+    // with its state bit, i.e. with the equation 0 = 1
+    for (std::size_t b = 0; b < count; b++)
+        solvable[first + b] = true;
+    for (std::size_t k = pivotCols.size(); k < n; k++)
+        for (std::size_t b = m[k].findFirst(n); b < m.columns();
+             b = m[k].findFirst(b + 1))
+            solvable[first + b - n] = false;
+
+    // the free unknowns are 0, so the toggles of a box are the pivot
+    // columns of the rows having its state bit set. The pivot columns
+    // grow with k, so the toggles are in the row-major order
+    for (std::size_t k = 0; k < pivotCols.size(); k++)
+        for (std::size_t b = m[k].findFirst(n); b < m.columns();
+             b = m[k].findFirst(b + 1))
+            if (solvable[first + b - n])
+                sequences[first + b - n].push_back(
+                    helpers::toCartesianCoordinates(pivotCols[k], x));
+}
@@ -0,0 +1,330 @@
+#include "BitKernels.h"
+#include <bit>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SECRET_BOX_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC allows the intrinsics of any instruction set without the flags
+#define SECRET_BOX_TARGET(isa)
+#else
+#define SECRET_BOX_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace SecureBoxHack
+{
+namespace kernels
+{
+namespace
+{
+constexpr std::size_t wordBits = sizeof(Word) * 8;
+
+void xorScalar(Word *dst, const Word *src, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i++)
+        dst[i] ^= src[i];
+}
+
+bool andParityScalar(const Word *a, const Word *b, std::size_t n)
+{
+    Word acc = 0;
+    for (std::size_t i = 0; i < n; i++)
+        acc ^= a[i] & b[i];
+    return std::popcount(acc) & 1;
+}
+
+/// @brief Returns the index of the lowest set bit of the word w
+std::size_t firstBit(std::size_t w, Word word)
+{
+    return w * wordBits + static_cast<std::size_t>(std::countr_zero(word));
+}
+
+/// @brief Finds the first set bit in the words [w, n).
+/// The word w is masked with the mask
+std::size_t findFirstSetTail(const Word *words,
+                             std::size_t n,
+                             std::size_t w,
+                             Word mask)
+{
+    for (Word cur = words[w] & mask;; cur = words[w])
+    {
+        if (cur)
+            return firstBit(w, cur);
+        if (++w == n)
+            return n * wordBits;
+    }
+}
+
+std::size_t findFirstSetScalar(const Word *words,
+                               std::size_t n,
+                               std::size_t from)
+{
+    if (from >= n * wordBits)
+        return n * wordBits;
+    return findFirstSetTail(
+        words, n, from / wordBits, ~static_cast<Word>(0) << (from % wordBits));
+}
+
+constexpr KernelTable scalarTable{
+    "scalar", xorScalar, andParityScalar, findFirstSetScalar};
+
+#ifdef SECRET_BOX_X86
+// SSE2 is the part of the x86-64 baseline, no target attribute required
+void xorSse2(Word *dst, const Word *src, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+        auto *d = reinterpret_cast<__m128i *>(dst + i);
+        const auto *s = reinterpret_cast<const __m128i *>(src + i);
+        _mm_storeu_si128(d,
+                         _mm_xor_si128(_mm_loadu_si128(d), _mm_loadu_si128(s)));
+    }
+    xorScalar(dst + i, src + i, n - i);
+}
+
+bool andParitySse2(const Word *a, const Word *b, std::size_t n)
+{
+    __m128i acc = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+        acc = _mm_xor_si128(
+            acc,
+            _mm_and_si128(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i))));
+
+    alignas(16) Word lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+    return (std::popcount(lanes[0] ^ lanes[1]) & 1) ^
+           andParityScalar(a + i, b + i, n - i);
+}
+
+std::size_t findFirstSetSse2(const Word *words, std::size_t n, std::size_t from)
+{
+    if (from >= n * wordBits)
+        return n * wordBits;
+
+    std::size_t w = from / wordBits;
+    const Word first = words[w] & (~static_cast<Word>(0) << (from % wordBits));
+    if (first)
+        return firstBit(w, first);
+
+    // skip the zero words two at a time
+    for (++w; w + 2 <= n; w += 2)
+    {
+        const __m128i v =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(words + w));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF)
+            break;
+    }
+    return w == n ? n * wordBits : findFirstSetTail(words, n, w, ~Word{});
+}
+
+constexpr KernelTable sse2Table{
+    "sse2", xorSse2, andParitySse2, findFirstSetSse2};
+
+SECRET_BOX_TARGET("avx2")
+void xorAvx2(Word *dst, const Word *src, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        auto *d = reinterpret_cast<__m256i *>(dst + i);
+        const auto *s = reinterpret_cast<const __m256i *>(src + i);
+        _mm256_storeu_si256(
+            d, _mm256_xor_si256(_mm256_loadu_si256(d), _mm256_loadu_si256(s)));
+    }
+    xorScalar(dst + i, src + i, n - i);
+}
+
+SECRET_BOX_TARGET("avx2")
+bool andParityAvx2(const Word *a, const Word *b, std::size_t n)
+{
+    __m256i acc = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        acc = _mm256_xor_si256(
+            acc,
+            _mm256_and_si256(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i))));
+
+    alignas(32) Word lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+    return (std::popcount(lanes[0] ^ lanes[1] ^ lanes[2] ^ lanes[3]) & 1) ^
+           andParityScalar(a + i, b + i, n - i);
+}
+
+SECRET_BOX_TARGET("avx2")
+std::size_t findFirstSetAvx2(const Word *words, std::size_t n, std::size_t from)
+{
+    if (from >= n * wordBits)
+        return n * wordBits;
+
+    std::size_t w = from / wordBits;
+    const Word first = words[w] & (~static_cast<Word>(0) << (from % wordBits));
+    if (first)
+        return firstBit(w, first);
+
+    // skip the zero words four at a time
+    for (++w; w + 4 <= n; w += 4)
+    {
+        const __m256i v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + w));
+        if (!_mm256_testz_si256(v, v))
+            break;
+    }
+    return w == n ? n * wordBits : findFirstSetTail(words, n, w, ~Word{});
+}
+
+constexpr KernelTable avx2Table{
+    "avx2", xorAvx2, andParityAvx2, findFirstSetAvx2};
+
+SECRET_BOX_TARGET("avx512f")
+void xorAvx512(Word *dst, const Word *src, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm512_storeu_si512(dst + i,
+                            _mm512_xor_si512(_mm512_loadu_si512(dst + i),
+                                             _mm512_loadu_si512(src + i)));
+    xorScalar(dst + i, src + i, n - i);
+}
+
+SECRET_BOX_TARGET("avx512f")
+bool andParityAvx512(const Word *a, const Word *b, std::size_t n)
+{
+    __m512i acc = _mm512_setzero_si512();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        acc = _mm512_xor_si512(
+            acc,
+            _mm512_and_si512(_mm512_loadu_si512(a + i),
+                             _mm512_loadu_si512(b + i)));
+
+    alignas(64) Word lanes[8];
+    _mm512_store_si512(lanes, acc);
+    Word folded = 0;
+    for (Word lane : lanes)
+        folded ^= lane;
+    return (std::popcount(folded) & 1) ^ andParityScalar(a + i, b + i, n - i);
+}
+
+SECRET_BOX_TARGET("avx512f")
+std::size_t findFirstSetAvx512(const Word *words,
+                               std::size_t n,
+                               std::size_t from)
+{
+    if (from >= n * wordBits)
+        return n * wordBits;
+
+    std::size_t w = from / wordBits;
+    const Word first = words[w] & (~static_cast<Word>(0) << (from % wordBits));
+    if (first)
+        return firstBit(w, first);
+
+    // skip the zero words eight at a time
+    for (++w; w + 8 <= n; w += 8)
+    {
+        const __m512i v = _mm512_loadu_si512(words + w);
+        if (_mm512_test_epi64_mask(v, v))
+            break;
+    }
+    return w == n ? n * wordBits : findFirstSetTail(words, n, w, ~Word{});
+}
+
+constexpr KernelTable avx512Table{
+    "avx512", xorAvx512, andParityAvx512, findFirstSetAvx512};
+
+#if defined(_MSC_VER) && !defined(__clang__)
+/// @brief Checks the CPUID feature bit and the OS support of the registers
+bool cpuSupports(int leaf, int reg, int bit, unsigned long long xcr0Mask)
+{
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < leaf)
+        return false;
+    __cpuidex(info, leaf, 0);
+    if (!(info[reg] & (1 << bit)))
+        return false;
+    __cpuid(info, 1);
+    // OSXSAVE is required to read the XCR0 register
+    if (!(info[2] & (1 << 27)))
+        return false;
+    return (_xgetbv(0) & xcr0Mask) == xcr0Mask;
+}
+
+bool hasAvx2()
+{
+    // leaf 7, EBX bit 5. XMM and YMM states are enabled by the OS
+    return cpuSupports(7, 1, 5, 0x6);
+}
+
+bool hasAvx512()
+{
+    // leaf 7, EBX bit 16. Opmask and ZMM states are enabled by the OS
+    return cpuSupports(7, 1, 16, 0xE6);
+}
+#else
+bool hasAvx2()
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+bool hasAvx512()
+{
+    return __builtin_cpu_supports("avx512f");
+}
+#endif
+#endif
+
+const KernelTable &selectKernels()
+{
+#ifdef SECRET_BOX_X86
+    if (hasAvx512())
+        return avx512Table;
+    if (hasAvx2())
+        return avx2Table;
+    return sse2Table;
+#else
+    return scalarTable;
+#endif
+}
+} // namespace
+
+const KernelTable &active()
+{
+    static const KernelTable &table = selectKernels();
+    return table;
+}
+
+void transpose64(Word *block)
+{
+    Word mask = 0x00000000FFFFFFFF;
+    for (std::size_t j = 32; j; j >>= 1, mask ^= mask << j)
+        // k runs over the rows with the bit j clear, k | j is its pair
+        for (std::size_t k = 0; k < 64; k = ((k | j) + 1) & ~j)
+        {
+            const Word t = ((block[k] >> j) ^ block[k | j]) & mask;
+            block[k] ^= t << j;
+            block[k | j] ^= t;
+        }
+}
+
+std::vector<const KernelTable *> available()
+{
+    std::vector<const KernelTable *> tables{&scalarTable};
+#ifdef SECRET_BOX_X86
+    tables.push_back(&sse2Table);
+    if (hasAvx2())
+        tables.push_back(&avx2Table);
+    if (hasAvx512())
+        tables.push_back(&avx512Table);
+#endif
+    return tables;
+}
+} // namespace kernels
+} // namespace SecureBoxHack
@@ -0,0 +1,146 @@
+#include "BitMatrix.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <numeric>
+#include <string>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace SecureBoxHack;
+
+namespace
+{
+// the storage smaller than a few huge pages doesn't benefit from them
+constexpr std::size_t hugePageBytes = 2 << 20;
+constexpr std::size_t minHugeBytes = 4 * hugePageBytes;
+constexpr std::size_t lineBits = BitMatrix::alignment * 8;
+} // namespace
+
+BitMatrix::BitMatrix(std::size_t rowsCount,
+                     std::size_t bitsCount,
+                     bool hugePages)
+    : cols(bitsCount), stride(strideFor(bitsCount)),
+      storage(allocate(rowsCount * stride * sizeof(Word), hugePages)),
+      order(rowsCount)
+{
+    std::iota(order.begin(), order.end(), std::size_t{0});
+}
+
+BitMatrix::BitMatrix(std::size_t rowsCount,
+                     std::size_t bitsCount,
+                     const std::filesystem::path &scratchDirectory)
+    : cols(bitsCount), stride(strideFor(bitsCount)), storage(),
+      order(rowsCount)
+{
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    const std::size_t bytes =
+        std::max(rowsCount * stride * sizeof(Word), alignment);
+
+#if defined(__linux__)
+    // the temporary directory is resolved here, so the invalid TMPDIR
+    // fails the matrix of the OutOfCore engine only
+    const std::filesystem::path directory =
+        scratchDirectory.empty() ? std::filesystem::temp_directory_path()
+                                 : scratchDirectory;
+    std::string path = (directory / "secret_box_XXXXXX").string();
+    const int fd = mkstemp(path.data());
+    if (fd >= 0)
+    {
+        unlink(path.c_str());
+        void *memory = MAP_FAILED;
+        // the truncated file reads as zeros
+        if (ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+            memory = mmap(nullptr,
+                          bytes,
+                          PROT_READ | PROT_WRITE,
+                          MAP_SHARED,
+                          fd,
+                          0);
+        close(fd);
+        if (memory != MAP_FAILED)
+        {
+            madvise(memory, bytes, MADV_SEQUENTIAL);
+            storage = {static_cast<Word *>(memory),
+                       Deleter{bytes, true, true}};
+            return;
+        }
+    }
+#else
+    (void)scratchDirectory;
+#endif
+    storage = allocate(bytes, false);
+}
+
+BitMatrix::BitMatrix(const Word *words,
+                     std::size_t rowsCount,
+                     std::size_t bitsCount)
+    : cols(bitsCount), stride(strideFor(bitsCount)),
+      storage(const_cast<Word *>(words), Deleter{0, false, false}),
+      order(rowsCount)
+{
+    std::iota(order.begin(), order.end(), std::size_t{0});
+}
+
+std::size_t BitMatrix::strideFor(std::size_t bitsCount)
+{
+    return std::max<std::size_t>(1, (bitsCount + lineBits - 1) / lineBits) *
+           lineWords;
+}
+
+void BitMatrix::reset()
+{
+    std::memset(storage.get(), 0, order.size() * stride * sizeof(Word));
+}
+
+std::unique_ptr<BitMatrix::Word[], BitMatrix::Deleter>
+BitMatrix::allocate(std::size_t bytes, bool hugePages)
+{
+    bytes = std::max(bytes, alignment);
+    instrumentation::count(instrumentation::Counter::BytesAllocated, bytes);
+#if defined(__linux__)
+    if (hugePages && bytes >= minHugeBytes)
+    {
+        // the anonymous mapping is zeroed and page aligned, so the kernel
+        // can back it with the transparent huge pages
+        bytes = (bytes + hugePageBytes - 1) / hugePageBytes * hugePageBytes;
+        void *memory = mmap(nullptr,
+                            bytes,
+                            PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS,
+                            -1,
+                            0);
+        if (memory != MAP_FAILED)
+        {
+            madvise(memory, bytes, MADV_HUGEPAGE);
+            return {static_cast<Word *>(memory), Deleter{bytes, true, true}};
+        }
+    }
+#else
+    (void)hugePages;
+#endif
+
+    auto *memory = static_cast<Word *>(
+        ::operator new(bytes, std::align_val_t{alignment}));
+    std::memset(memory, 0, bytes);
+    return {memory, Deleter{bytes, false, true}};
+}
+
+void BitMatrix::Deleter::operator()(Word *words) const
+{
+    if (!owned)
+        return;
+#if defined(__linux__)
+    if (mapped)
+    {
+        munmap(words, bytes);
+        return;
+    }
+#endif
+    ::operator delete(words, std::align_val_t{alignment});
+}
@@ -0,0 +1,372 @@
+#include "BlockLanczos.h"
+#include <array>
+#include <bit>
+#include <memory>
+#include <random>
+#include <utility>
+
+namespace SecureBoxHack
+{
+namespace lanczos
+{
+namespace
+{
+using Word = kernels::Word;
+/// @brief The 64 x 64 matrix, the word k is the row k
+using Square = std::array<Word, blockWidth>;
+/// @brief The tables of the XORs of the rows selected by every byte
+using ByteTables = std::array<std::array<Word, 256>, sizeof(Word)>;
+
+constexpr Word bit(std::size_t k)
+{
+    return Word{1} << k;
+}
+
+Square identity()
+{
+    Square m{};
+    for (std::size_t k = 0; k < blockWidth; k++)
+        m[k] = bit(k);
+    return m;
+}
+
+bool isZero(const Square &m)
+{
+    for (Word row : m)
+        if (row)
+            return false;
+    return true;
+}
+
+/// @brief Returns a * b
+Square multiply(const Square &a, const Square &b)
+{
+    Square c{};
+    for (std::size_t i = 0; i < blockWidth; i++)
+        for (Word row = a[i]; row; row &= row - 1)
+            c[i] ^= b[static_cast<std::size_t>(std::countr_zero(row))];
+    return c;
+}
+
+/// @brief out ^= v * m. The product of every row takes 8 table lookups
+void multiplyAdd(const Block &v, const Square &m, Block &out)
+{
+    auto tables = std::make_unique<ByteTables>();
+    for (std::size_t j = 0; j < sizeof(Word); j++)
+    {
+        auto &table = (*tables)[j];
+        table[0] = 0;
+        for (std::size_t byte = 1; byte < 256; byte++)
+        {
+            const auto low = static_cast<std::size_t>(std::countr_zero(byte));
+            table[byte] = table[byte & (byte - 1)] ^ m[8 * j + low];
+        }
+    }
+
+    for (std::size_t r = 0; r < v.size(); r++)
+    {
+        Word row = 0;
+        for (std::size_t j = 0; j < sizeof(Word); j++)
+            row ^= (*tables)[j][(v[r] >> (8 * j)) & 0xff];
+        out[r] ^= row;
+    }
+}
+
+/// @brief Returns u^T * v. The rows of v are accumulated per every byte
+/// of the row of u first and spread over the 8 bits of the byte at the end
+Square innerProduct(const Block &u, const Block &v)
+{
+    auto sums = std::make_unique<ByteTables>();
+    for (std::size_t r = 0; r < u.size(); r++)
+        for (std::size_t j = 0; j < sizeof(Word); j++)
+            (*sums)[j][(u[r] >> (8 * j)) & 0xff] ^= v[r];
+
+    Square m{};
+    for (std::size_t j = 0; j < sizeof(Word); j++)
+        for (std::size_t byte = 1; byte < 256; byte++)
+            for (std::size_t b = 0; b < 8; b++)
+                if (byte & bit(b))
+                    m[8 * j + b] ^= (*sums)[j][byte];
+    return m;
+}
+
+/// @brief Selects the columns S of V with the invertible S^T * T * S for
+/// T = V^T * A * V as described by Montgomery. The columns not selected
+/// in the previous iteration have the priority and have to be selected
+/// @param t The matrix V^T * A * V
+/// @param previous The columns selected in the previous iteration
+/// @param winv Receives S * (S^T * T * S)^-1 * S^T
+/// @param mask Receives the selected columns
+/// @return false if the iteration broke down
+bool selectColumns(const Square &t, Word previous, Square &winv, Word &mask)
+{
+    Square left = t;
+    Square right = identity();
+
+    std::array<std::size_t, blockWidth> cols{};
+    std::size_t count = 0;
+    for (std::size_t k = 0; k < blockWidth; k++)
+        if (!(previous & bit(k)))
+            cols[count++] = k;
+    for (std::size_t k = 0; k < blockWidth; k++)
+        if (previous & bit(k))
+            cols[count++] = k;
+
+    mask = 0;
+    for (std::size_t i = 0; i < blockWidth; i++)
+    {
+        const std::size_t c = cols[i];
+        std::size_t j = i;
+        for (; j < blockWidth && !(left[cols[j]] & bit(c)); j++)
+        { // searching for the pivot in the left half
+        }
+
+        if (j < blockWidth)
+        {
+            std::swap(left[c], left[cols[j]]);
+            std::swap(right[c], right[cols[j]]);
+            mask |= bit(c);
+            for (std::size_t k = 0; k < blockWidth; k++)
+                if (k != c && (left[k] & bit(c)))
+                {
+                    left[k] ^= left[c];
+                    right[k] ^= right[c];
+                }
+            continue;
+        }
+
+        // the column is dependent, clear it from the right half
+        for (j = i; j < blockWidth && !(right[cols[j]] & bit(c)); j++)
+        { // searching for the pivot in the right half
+        }
+        if (j == blockWidth)
+            return false;
+
+        std::swap(left[c], left[cols[j]]);
+        std::swap(right[c], right[cols[j]]);
+        for (std::size_t k = 0; k < blockWidth; k++)
+            if (k != c && (right[k] & bit(c)))
+            {
+                left[k] ^= left[c];
+                right[k] ^= right[c];
+            }
+        left[c] = 0;
+        right[c] = 0;
+    }
+
+    winv = right;
+    // the columns skipped twice in a row would never be A-orthogonalized
+    return (mask | previous) == ~Word{0};
+}
+
+/// @brief Combines the solution and the null space vectors from the
+/// candidate blocks, solving A * Z * c = b with the dense elimination
+/// of the N x 128 images of the candidates
+/// @return the outcome of the combination
+Outcome combine(const SymmetricOperator &a,
+                const DynamicBitset &b,
+                const Block &z0,
+                const Block &z1,
+                DynamicBitset &x)
+{
+    constexpr std::size_t columns = 2 * blockWidth;
+    const std::size_t n = z0.size();
+
+    Block az0(n), az1(n);
+    a(z0, az0);
+    a(z1, az1);
+
+    // the row r of the system [A * Z | b]
+    struct Row
+    {
+        Word lo, hi;
+        bool rhs;
+
+        bool test(std::size_t c) const
+        {
+            return (c < blockWidth ? lo >> c : hi >> (c - blockWidth)) & 1;
+        }
+    };
+    std::vector<Row> rows(n);
+    for (std::size_t r = 0; r < n; r++)
+        rows[r] = {az0[r], az1[r], b.test(r)};
+
+    std::vector<std::size_t> pivotCols;
+    for (std::size_t c = 0; c < columns && pivotCols.size() < n; c++)
+    {
+        const std::size_t k = pivotCols.size();
+        std::size_t j = k;
+        for (; j < n && !rows[j].test(c); j++)
+        { // searching for the pivot
+        }
+        if (j == n)
+            continue;
+
+        std::swap(rows[k], rows[j]);
+        for (std::size_t i = 0; i < n; i++)
+            if (i != k && rows[i].test(c))
+            {
+                rows[i].lo ^= rows[k].lo;
+                rows[i].hi ^= rows[k].hi;
+                rows[i].rhs ^= rows[k].rhs;
+            }
+        pivotCols.push_back(c);
+    }
+
+    // Z * c for the coefficients of the candidate columns
+    auto apply = [&](Word lo, Word hi, DynamicBitset &v) {
+        for (std::size_t r = 0; r < n; r++)
+            v.set(r, std::popcount((z0[r] & lo) ^ (z1[r] & hi)) & 1);
+    };
+
+    bool consistent = true;
+    for (std::size_t k = pivotCols.size(); k < n && consistent; k++)
+        consistent = !rows[k].rhs;
+    if (consistent)
+    {
+        // the free coefficients are 0
+        Word lo = 0, hi = 0;
+        for (std::size_t k = 0; k < pivotCols.size(); k++)
+            if (rows[k].rhs)
+                (pivotCols[k] < blockWidth ? lo : hi) |=
+                    bit(pivotCols[k] % blockWidth);
+        apply(lo, hi, x);
+        return Outcome::Solved;
+    }
+
+    // every free column gives the combination with A * Z * c = 0.
+    // b is orthogonal to the null space of the symmetric A if A * x = b
+    // has the solution, so the null vector with the odd product with b
+    // proves there is no solution
+    DynamicBitset nullVector(n);
+    for (std::size_t f = 0, k = 0; f < columns; f++)
+    {
+        if (k < pivotCols.size() && pivotCols[k] == f)
+        {
+            k++;
+            continue;
+        }
+
+        Word lo = 0, hi = 0;
+        (f < blockWidth ? lo : hi) |= bit(f % blockWidth);
+        for (std::size_t p = 0; p < pivotCols.size(); p++)
+            if (rows[p].test(f))
+                (pivotCols[p] < blockWidth ? lo : hi) |=
+                    bit(pivotCols[p] % blockWidth);
+        apply(lo, hi, nullVector);
+        if (nullVector.andParity(b))
+            return Outcome::Unsolvable;
+    }
+    return Outcome::Failed;
+}
+
+/// @brief Runs the single attempt of the block Lanczos iteration
+Outcome attempt(const SymmetricOperator &a,
+                const DynamicBitset &b,
+                DynamicBitset &x,
+                std::mt19937_64 &rng)
+{
+    const std::size_t n = b.size();
+
+    Block y(n);
+    for (auto &word : y)
+        word = rng();
+
+    // V0 = A * Y + b * e0
+    Block v0(n);
+    a(y, v0);
+    for (std::size_t r = 0; r < n; r++)
+        v0[r] ^= static_cast<Word>(b.test(r));
+    const Block initial = v0;
+
+    Block v1(n, 0), v2(n, 0), av(n), next(n), solution(n, 0);
+    Square winv0{}, winv1{}, winv2{};
+    Square vtav1{}, vta2v1{};
+    Word mask0 = 0, mask1 = ~Word{0};
+
+    // the dimension grows by about 63 every iteration
+    const std::size_t maxIterations = n / (blockWidth - 4) + 16;
+    for (std::size_t iteration = 0;; iteration++)
+    {
+        a(v0, av);
+        const Square vtav0 = innerProduct(v0, av);
+        if (isZero(vtav0))
+            break;
+        if (iteration == maxIterations)
+            return Outcome::Failed;
+
+        // the breakdown happens when the block has lost its rank, e.g. when
+        // the Krylov space is exhausted. The candidates collected so far
+        // are still combined
+        if (!selectColumns(vtav0, mask1, winv0, mask0))
+            break;
+        const Square vta2v0 = innerProduct(av, av);
+
+        // X += V * Winv * V^T * V0
+        multiplyAdd(v0, multiply(winv0, innerProduct(v0, initial)), solution);
+
+        // D = I - Winv0 * (V0^T * A^2 * V0 * S0 * S0^T + V0^T * A * V0)
+        Square d{};
+        for (std::size_t k = 0; k < blockWidth; k++)
+            d[k] = (vta2v0[k] & mask0) ^ vtav0[k];
+        d = multiply(winv0, d);
+        for (std::size_t k = 0; k < blockWidth; k++)
+            d[k] ^= bit(k);
+
+        // E = -Winv1 * V0^T * A * V0 * S0 * S0^T
+        Square e{};
+        for (std::size_t k = 0; k < blockWidth; k++)
+            e[k] = vtav0[k] & mask0;
+        e = multiply(winv1, e);
+
+        // F = -Winv2 * (I - V1^T * A * V1 * Winv1) *
+        //     (V1^T * A^2 * V1 * S1 * S1^T + V1^T * A * V1) * S0 * S0^T
+        Square f = multiply(vtav1, winv1);
+        for (std::size_t k = 0; k < blockWidth; k++)
+            f[k] ^= bit(k);
+        f = multiply(winv2, f);
+        Square f2{};
+        for (std::size_t k = 0; k < blockWidth; k++)
+            f2[k] = ((vta2v1[k] & mask1) ^ vtav1[k]) & mask0;
+        f = multiply(f, f2);
+
+        // V' = A * V0 * S0 * S0^T + V0 * D + V1 * E + V2 * F
+        for (std::size_t r = 0; r < n; r++)
+            next[r] = av[r] & mask0;
+        multiplyAdd(v0, d, next);
+        multiplyAdd(v1, e, next);
+        multiplyAdd(v2, f, next);
+
+        std::swap(v2, v1);
+        std::swap(v1, v0);
+        std::swap(v0, next);
+        winv2 = winv1;
+        winv1 = winv0;
+        mask1 = mask0;
+        vtav1 = vtav0;
+        vta2v1 = vta2v0;
+    }
+
+    // A * X = V0 = A * Y + b * e0 if the iteration ended with V = 0,
+    // otherwise the last V completes the candidates
+    for (std::size_t r = 0; r < n; r++)
+        solution[r] ^= y[r];
+    return combine(a, b, solution, v0, x);
+}
+} // namespace
+
+Outcome solve(const SymmetricOperator &a,
+              const DynamicBitset &b,
+              DynamicBitset &x,
+              uint64_t seed,
+              std::size_t attempts)
+{
+    x = DynamicBitset(b.size());
+    std::mt19937_64 rng(seed);
+    for (std::size_t i = 0; i < attempts; i++)
+        if (auto outcome = attempt(a, b, x, rng); outcome != Outcome::Failed)
+            return outcome;
+    return Outcome::Failed;
+}
+} // namespace lanczos
+} // namespace SecureBoxHack
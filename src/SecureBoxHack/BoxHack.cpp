@@ -1,93 +1,246 @@
 #include "BoxHack.h"
+#include "FourRussians.h"
+#include "Instrumentation.h"
+#include "MinimumToggles.h"
+#include "NaiveElimination.h"
+#include "OutOfCoreElimination.h"
+#include "ParallelElimination.h"
+#include "Planner.h"
+#include "Solvability.h"
 #include "helpers.h"
-#include <ranges>
+#include <bit>
+#include <stdexcept>
 
 using namespace SecureBoxHack;
 
-std::vector<std::tuple<uint32_t, uint32_t>> BoxHack::getUnlockSequence()
+namespace
 {
-    buildGaussMatrix();
+/// @brief Checks the size of the packed state and its parity invariants
+bool checkState(std::span<const uint64_t> packedState,
+                std::size_t y,
+                std::size_t x)
+{
+    if (packedState.size() * 64 < y * x)
+        throw std::invalid_argument("BoxHack packed state is too short");
+    return solvability::isSolvable(packedState,
+                                   static_cast<uint32_t>(y),
+                                   static_cast<uint32_t>(x));
+}
+
+/// @brief Replaces Auto with the engine planned for the shape. The rejected
+/// state isn't eliminated, so its shape isn't planned
+EliminationEngine resolveEngine(EliminationEngine elimination,
+                                bool solvable,
+                                uint32_t y,
+                                uint32_t x)
+{
+    if (elimination != EliminationEngine::Auto)
+        return elimination;
+    return solvable ? Planner::shared().engineFor(y, x)
+                    : EliminationEngine::Naive;
+}
+} // namespace
+
+BoxHack::BoxHack(const BoolMatrix &initialState,
+                 EliminationEngine elimination,
+                 bool minimizeToggles,
+                 const elimination::OutOfCoreOptions &outOfCore)
+    : BoxHack(helpers::packState(initialState),
+              static_cast<uint32_t>(initialState.size()),
+              static_cast<uint32_t>(helpers::stateWidth(initialState)),
+              elimination,
+              minimizeToggles,
+              outOfCore)
+{
+}
+
+BoxHack::BoxHack(std::span<const uint64_t> packedState,
+                 uint32_t height,
+                 uint32_t width,
+                 EliminationEngine elimination,
+                 bool minimizeToggles,
+                 const elimination::OutOfCoreOptions &outOfCore)
+    : y(height), x(width), solvable(checkState(packedState, y, x)),
+      engine(resolveEngine(elimination, solvable, height, width)),
+      m(!solvable ? GaussMatrix(0, 0)
+        : engine == EliminationEngine::OutOfCore
+            ? GaussMatrix(y * x, y * x + 1, outOfCore.scratchDirectory)
+            : GaussMatrix(y * x, y * x + 1, true)),
+      minimize(minimizeToggles), outOfCoreBudget(outOfCore.budgetBytes)
+{
+    if (solvable)
+        fillInitialState(packedState);
+}
+
+ToggleSequence BoxHack::getUnlockSequence()
+{
+    using instrumentation::Phase;
+    using instrumentation::PhaseTimer;
+    instrumentation::count(instrumentation::Counter::Solves);
+
+    if (!solvable)
+    {
+        instrumentation::count(instrumentation::Counter::EarlyRejects);
+        helpers::logMessage("The state can't be unlocked");
+        return {};
+    }
+
+    {
+        PhaseTimer timer(Phase::BuildGaussMatrix);
+        buildGaussMatrix();
+    }
     helpers::logMatrix(m, "Gaussian matrix builded");
 
-    echelonGaussMatrix();
+    {
+        PhaseTimer timer(Phase::Elimination);
+        echelonGaussMatrix();
+    }
     helpers::logMatrix(m, "Echelon form builded");
 
-    std::vector<bool> linearSystemSolution(m.size(), false);
-    std::vector<std::tuple<uint32_t, uint32_t>> togglCells;
+    BitMatrix solution(1, m.columns());
+    bool consistent = false;
+    {
+        PhaseTimer timer(Phase::BackSubstitution);
+        consistent = backSubstitute(solution[0]);
+    }
 
-    std::size_t i = m.size() - 1;
-    do
+    solvable = consistent;
+    if (!consistent)
+        helpers::logMessage("The state can't be unlocked");
+    else if (minimize)
     {
-        bool value = m[i].back();
+        PhaseTimer timer(Phase::Minimization);
+        const std::size_t before = minimization::weight(solution[0]);
+        const std::size_t after =
+            minimization::minimizeToggles(solution[0], buildNullBasis());
+
+        helpers::logFormat(helpers::LogLevel::INFO,
+                           "Toggles minimized from %zu to %zu",
+                           before,
+                           after);
+    }
+
+    ToggleSequence togglCells;
+    for (std::size_t i = solution[0].findFirst(); i < m.size();
+         i = solution[0].findFirst(i + 1))
+        togglCells.push_back(helpers::toCartesianCoordinates(i, x));
+
+    helpers::logFormat(helpers::LogLevel::INFO,
+                       "Solution found. Reuires %zu toggles",
+                       togglCells.size());
+
+    return togglCells;
+}
 
-        // the 'x' component is missing. leave the value as 0 and continue
-        if (!m[i].test(i) && value)
+bool BoxHack::isSolvable() const
+{
+    return solvable;
+}
+
+bool BoxHack::backSubstitute(BitRow solution) const
+{
+    bool consistent = true;
+    std::size_t freeUnknowns = 0;
+    for (std::size_t i = m.size(); i-- > 0;)
+    {
+        // The unknowns after i are already solved while the rest of the
+        // solution is still zero, so the whole row can be multiplied
+        // by the solution at once. The last column is always zero there
+        const bool value = m[i].back() ^ m[i].andParity(solution);
+
+        // the 'x' component is missing. The unknown is free, leave it as 0.
+        // The equation left in the row has to be satisfied already
+        if (!m[i].test(i))
+        {
+            consistent = consistent && !value;
+            freeUnknowns++;
             continue;
+        }
 
-        for (std::size_t j = m[i].size() - 2; j != i; j--)
-            if (m[i].test(j))
-                value = value ^ linearSystemSolution[j];
+        solution.set(i, value);
+    }
 
-        linearSystemSolution[i] = value;
-        if (value)
-            togglCells.push_back(helpers::toCartesianCoordinates(i, x));
-    } while (i-- != 0);
+    instrumentation::count(instrumentation::Counter::Pivots,
+                           m.size() - freeUnknowns);
+    instrumentation::count(instrumentation::Counter::FreeVariables,
+                           freeUnknowns);
+    return consistent;
+}
 
-    char buffer[100];
-    snprintf(buffer,
-             100,
-             "Solution found. Reuires %zu toggles",
-             togglCells.size());
-    helpers::logMessage(buffer);
+BitMatrix BoxHack::buildNullBasis() const
+{
+    std::vector<std::size_t> freeUnknowns;
+    for (std::size_t i = 0; i < m.size(); i++)
+        if (!m[i].test(i))
+            freeUnknowns.push_back(i);
 
-    return {togglCells.rbegin(), togglCells.rend()};
+    BitMatrix basis(freeUnknowns.size(), m.columns());
+    for (std::size_t k = 0; k < freeUnknowns.size(); k++)
+    {
+        const std::size_t f = freeUnknowns[k];
+        basis[k].set(f);
+        // the pivot rows after f have no coefficients up to f
+        for (std::size_t i = f; i-- > 0;)
+            if (m[i].test(i))
+                basis[k].set(i, m[i].andParity(basis[k]));
+    }
+    return basis;
 }
 
 void BoxHack::buildGaussMatrix()
 {
+    // the state column is filled by the constructor
     for (std::size_t i = 0; i < y * x; i++)
         fillGaussRow(m[i], i);
-    fillInitialState();
 }
 
-void BoxHack::fillGaussRow(DynamicBitset &row, std::size_t rowI)
+void BoxHack::fillGaussRow(BitRow row, std::size_t rowI)
 {
-    // the cell coordinates
-    auto [posY, posX] = helpers::toCartesianCoordinates(rowI, x);
-    // fill the column
-    for (uint32_t j = 0; j < y; j++)
-        row.set(j * x + posX);
-    // fill the row
-    for (uint32_t j = 0; j < x; j++)
-        row.set(posY * x + j);
+    helpers::fillToggleRow(row, rowI, y, x);
 }
 
-void BoxHack::fillInitialState()
+void BoxHack::fillInitialState(std::span<const uint64_t> packedState)
 {
+    // the matrix is cleared, so only the locked cells are visited
     const std::size_t size = x * y;
-    auto stateJoinView = state | std::views::join;
-    auto cur = stateJoinView.begin();
-
-    for (std::size_t i = 0; i < size; i++, cur++)
-        m[i].set(size, *cur);
+    for (std::size_t w = 0; w < (size + 63) / 64; w++)
+        for (uint64_t word = packedState[w]; word; word &= word - 1)
+            if (const std::size_t i = w * 64 + static_cast<std::size_t>(
+                                                   std::countr_zero(word));
+                i < size)
+                m[i].set(size);
 }
 
 void BoxHack::echelonGaussMatrix()
 {
-    for (uint32_t i = 0, j = 0; i < m.size() - 1; ++i, j = i)
+    switch (engine)
     {
-        for (; j < m.size() && !m[j].test(i); j++)
-        { // searching for the row with Xi component equal true
-        }
-        if (j == m.size())
-            continue; // if Xi component is false consider its value in the solution as false
-        if (j != i)
-            std::swap(m[i], m[j]);
-        else
-            j++;
-
-        for (; j < m.size(); j++)
-            if (m[j].test(i))
-                m[j] ^= m[i];
+    case EliminationEngine::FourRussians:
+        return elimination::echelonFourRussians(m);
+    case EliminationEngine::Parallel:
+        return elimination::echelonParallel(m, ThreadPool::shared());
+    case EliminationEngine::OutOfCore:
+    {
+        const auto stats = elimination::echelonOutOfCore(
+            m, outOfCoreBudget);
+
+        helpers::logFormat(helpers::LogLevel::INFO,
+                           "Out-of-core elimination read %zu bytes, "
+                           "wrote %zu bytes in %zu panels",
+                           stats.bytesRead,
+                           stats.bytesWritten,
+                           stats.panels);
+        instrumentation::count(
+            instrumentation::Counter::WordsTouched,
+            (stats.bytesRead + stats.bytesWritten) / sizeof(BitMatrix::Word));
+        return;
+    }
+    case EliminationEngine::Naive:
+    case EliminationEngine::Auto:
+        break;
     }
+    elimination::echelonNaive(m,
+                              m.size() < elimination::columnSearchRows
+                                  ? elimination::PivotSearch::Rows
+                                  : elimination::PivotSearch::Columns);
 }
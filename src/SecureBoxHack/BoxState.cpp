@@ -0,0 +1,83 @@
+#include "BoxState.h"
+
+using namespace SecureBoxHack;
+
+BoxState::BoxState(uint32_t height, uint32_t width)
+    : y(height), x(width), cells(height, width), ones(1, width)
+{
+    for (std::size_t j = 0; j < x; j++)
+        ones[0].set(j);
+}
+
+BoxState::BoxState(const BoolMatrix &state)
+    : BoxState(static_cast<uint32_t>(state.size()),
+               static_cast<uint32_t>(state[0].size()))
+{
+    for (std::size_t i = 0; i < y; i++)
+        for (std::size_t j = 0; j < x; j++)
+            if (state[i][j])
+                cells[i].set(j);
+}
+
+void BoxState::toggle(uint32_t posY, uint32_t posX)
+{
+    // the cell is flipped by the row and by the column, so it's flipped
+    // the third time to match SecureBox
+    cells[posY] ^= ones[0];
+    for (std::size_t i = 0; i < y; i++)
+        cells[i].set(posX, !cells[i].test(posX));
+    cells[posY].set(posX, !cells[posY].test(posX));
+}
+
+void BoxState::apply(const ToggleSequence &toggles)
+{
+    BitMatrix colToggles(1, x);
+    std::vector<bool> rowToggles(y);
+    for (auto [posY, posX] : toggles)
+    {
+        rowToggles[posY] = !rowToggles[posY];
+        colToggles[0].set(posX, !colToggles[0].test(posX));
+        cells[posY].set(posX, !cells[posY].test(posX));
+    }
+
+    for (std::size_t i = 0; i < y; i++)
+    {
+        cells[i] ^= colToggles[0];
+        if (rowToggles[i])
+            cells[i] ^= ones[0];
+    }
+}
+
+bool BoxState::isLocked() const
+{
+    // the padding bits of the rows are always zero, so the whole words
+    // are scanned
+    for (auto row : cells)
+        if (row.findFirst() < row.size())
+            return true;
+    return false;
+}
+
+bool BoxState::test(uint32_t posY, uint32_t posX) const
+{
+    return cells[posY].test(posX);
+}
+
+BoolMatrix BoxState::getState() const
+{
+    BoolMatrix state(y, std::vector<bool>(x));
+    for (std::size_t i = 0; i < y; i++)
+        for (std::size_t j = 0; j < x; j++)
+            state[i][j] = cells[i].test(j);
+    return state;
+}
+
+uint32_t BoxState::height() const
+{
+    return y;
+}
+
+uint32_t BoxState::width() const
+{
+    return x;
+}
@@ -0,0 +1,78 @@
+#include "Cancellation.h"
+
+namespace SecureBoxHack
+{
+SolveStopped::SolveStopped(Reason stopReason)
+    : std::runtime_error(stopReason == Reason::Cancelled
+                             ? "The solve is cancelled"
+                             : "The solve deadline is exceeded"),
+      why(stopReason)
+{
+}
+
+SolveStopped::Reason SolveStopped::reason() const
+{
+    return why;
+}
+
+CancellationToken::CancellationToken()
+    : flag(std::make_shared<std::atomic<bool>>(false))
+{
+}
+
+void CancellationToken::cancel() const
+{
+    flag->store(true, std::memory_order_relaxed);
+}
+
+bool CancellationToken::isCancelled() const
+{
+    return flag->load(std::memory_order_relaxed);
+}
+
+namespace cancellation
+{
+namespace
+{
+// the condition of the solve running on the thread
+thread_local const StopCondition *current = nullptr;
+} // namespace
+
+std::optional<SolveStopped::Reason> StopCondition::check() const
+{
+    if (token.isCancelled())
+        return SolveStopped::Reason::Cancelled;
+    if (deadline != Clock::time_point::max() && Clock::now() >= deadline)
+        return SolveStopped::Reason::DeadlineExceeded;
+    return std::nullopt;
+}
+
+Scope::Scope(const StopCondition &condition) : previous(current)
+{
+    current = &condition;
+}
+
+Scope::~Scope()
+{
+    current = previous;
+}
+
+const StopCondition *installed()
+{
+    return current;
+}
+
+bool stopRequested()
+{
+    return current && current->check().has_value();
+}
+
+void checkpoint()
+{
+    if (!current)
+        return;
+    if (const auto reason = current->check())
+        throw SolveStopped(*reason);
+}
+} // namespace cancellation
+} // namespace SecureBoxHack
@@ -0,0 +1,131 @@
+#include "Factorization.h"
+#include "FourRussians.h"
+#include "MinimumToggles.h"
+#include "helpers.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+using namespace SecureBoxHack;
+
+Factorization::Factorization(uint32_t height, uint32_t width)
+    : y(height), x(width), n(std::size_t{height} * width), r(0), backing(),
+      inverse(n, n), nullBasis(0, n)
+{
+    constexpr std::size_t wordBits = sizeof(BitMatrix::Word) * 8;
+    // the identity starts at the word boundary, so the right half
+    // can be copied word by word
+    const std::size_t offset = (n + wordBits - 1) / wordBits * wordBits;
+
+    BitMatrix m(n, offset + n, true);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        helpers::fillToggleRow(m[i], i, y, x);
+        m[i].set(offset + i);
+    }
+
+    // E * A = R. The pivot row k solves the unknown of its pivot column
+    // while the rows without the pivot are the left null space of A
+    const auto pivotCols = elimination::reduceFourRussians(m, n, true);
+    r = pivotCols.size();
+    nullBasis = BitMatrix(n - r, n);
+
+    const std::size_t words = offset / wordBits;
+    for (std::size_t k = 0; k < n; k++)
+    {
+        const BitMatrix::Word *right = m.rowData(k) + words;
+        auto *target = k < r ? inverse.rowData(pivotCols[k])
+                             : nullBasis.rowData(k - r);
+        std::copy(right, right + words, target);
+    }
+}
+
+Factorization::Factorization(uint32_t height,
+                             uint32_t width,
+                             BitMatrix pseudoInverse,
+                             BitMatrix nullSpace,
+                             std::shared_ptr<const void> storage)
+    : y(height), x(width), n(std::size_t{height} * width),
+      r(n - std::min(n, nullSpace.size())), backing(std::move(storage)),
+      inverse(std::move(pseudoInverse)), nullBasis(std::move(nullSpace))
+{
+    if (inverse.size() != n || inverse.columns() != n ||
+        nullBasis.columns() != n || nullBasis.size() > n)
+        throw std::invalid_argument("Factorization artifacts size mismatch");
+}
+
+uint32_t Factorization::height() const
+{
+    return y;
+}
+
+uint32_t Factorization::width() const
+{
+    return x;
+}
+
+std::size_t Factorization::rank() const
+{
+    return r;
+}
+
+std::size_t Factorization::memoryUsage() const
+{
+    return (inverse.size() + nullBasis.size()) * inverse.rowStride() *
+           sizeof(BitMatrix::Word);
+}
+
+const BitMatrix &Factorization::pseudoInverse() const
+{
+    return inverse;
+}
+
+const BitMatrix &Factorization::nullSpace() const
+{
+    return nullBasis;
+}
+
+bool Factorization::solve(ConstBitRow state, BitRow solution) const
+{
+    if (state.wordCount() < inverse.rowStride() ||
+        solution.wordCount() < inverse.rowStride())
+        throw std::invalid_argument("Factorization rows size mismatch");
+
+    for (std::size_t k = 0; k < nullBasis.size(); k++)
+        if (nullBasis[k].andParity(state))
+            return false;
+
+    for (std::size_t i = 0; i < n; i++)
+        solution.set(i, inverse[i].andParity(state));
+    return true;
+}
+
+ToggleSequence Factorization::getUnlockSequence(const BoolMatrix &state,
+                                                bool minimize) const
+{
+    BitMatrix packed(2, n);
+    for (std::size_t i = 0; i < y; i++)
+        for (std::size_t j = 0; j < x; j++)
+            packed[0].set(i * x + j, state[i][j]);
+
+    ToggleSequence togglCells;
+    if (!solve(packed[0], packed[1]))
+        return togglCells;
+
+    if (minimize)
+    {
+        const std::size_t before = minimization::weight(packed[1]);
+        const std::size_t after =
+            minimization::minimizeToggles(packed[1], nullBasis);
+
+        helpers::logFormat(helpers::LogLevel::INFO,
+                           "Toggles minimized from %zu to %zu",
+                           before,
+                           after);
+    }
+
+    for (std::size_t i = packed[1].findFirst(); i < n;
+         i = packed[1].findFirst(i + 1))
+        togglCells.push_back(helpers::toCartesianCoordinates(i, x));
+    return togglCells;
+}
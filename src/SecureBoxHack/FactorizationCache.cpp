@@ -0,0 +1,141 @@
+#include "FactorizationCache.h"
+#include "FactorizationStore.h"
+#include "helpers.h"
+#include <stdexcept>
+
+using namespace SecureBoxHack;
+
+FactorizationCache::FactorizationCache(std::size_t budgetBytes)
+    : mutex(), limit(budgetBytes), used(0), uses(), entries(),
+      storeDirectory()
+{
+}
+
+std::shared_ptr<const Factorization> FactorizationCache::get(uint32_t y,
+                                                             uint32_t x)
+{
+    const Key key = toKey(y, x);
+    {
+        std::lock_guard lock(mutex);
+        if (auto it = entries.find(key); it != entries.end())
+        {
+            uses.splice(uses.begin(), uses, it->second.use);
+            return it->second.value;
+        }
+    }
+
+    // the elimination takes long, so don't block the other shapes
+    auto value = build(y, x);
+    const std::size_t bytes = value->memoryUsage();
+    if (bytes > limit)
+        return value;
+
+    std::lock_guard lock(mutex);
+    if (auto it = entries.find(key); it != entries.end())
+    {
+        // built concurrently by another thread
+        uses.splice(uses.begin(), uses, it->second.use);
+        return it->second.value;
+    }
+
+    uses.push_front(key);
+    entries.emplace(key, Entry{value, uses.begin()});
+    used += bytes;
+    evict();
+    return value;
+}
+
+void FactorizationCache::setBudget(std::size_t budgetBytes)
+{
+    std::lock_guard lock(mutex);
+    limit = budgetBytes;
+    evict();
+}
+
+void FactorizationCache::setStoreDirectory(std::filesystem::path directory)
+{
+    std::lock_guard lock(mutex);
+    storeDirectory = std::move(directory);
+}
+
+std::size_t FactorizationCache::budget() const
+{
+    std::lock_guard lock(mutex);
+    return limit;
+}
+
+std::size_t FactorizationCache::memoryUsage() const
+{
+    std::lock_guard lock(mutex);
+    return used;
+}
+
+std::size_t FactorizationCache::size() const
+{
+    std::lock_guard lock(mutex);
+    return entries.size();
+}
+
+bool FactorizationCache::contains(uint32_t y, uint32_t x) const
+{
+    std::lock_guard lock(mutex);
+    return entries.contains(toKey(y, x));
+}
+
+void FactorizationCache::clear()
+{
+    std::lock_guard lock(mutex);
+    entries.clear();
+    uses.clear();
+    used = 0;
+}
+
+FactorizationCache &FactorizationCache::shared()
+{
+    static FactorizationCache cache;
+    return cache;
+}
+
+FactorizationCache::Key FactorizationCache::toKey(uint32_t y, uint32_t x)
+{
+    return Key{y} << 32 | x;
+}
+
+std::shared_ptr<const Factorization> FactorizationCache::build(uint32_t y,
+                                                               uint32_t x) const
+{
+    std::filesystem::path path;
+    {
+        std::lock_guard lock(mutex);
+        if (!storeDirectory.empty())
+            path = storeDirectory / store::fileName(y, x);
+    }
+
+    if (!path.empty() && std::filesystem::exists(path))
+    {
+        try
+        {
+            auto value = store::load(path);
+            if (value->height() == y && value->width() == x)
+                return value;
+            helpers::logMessage("The stored shape mismatch " + path.string());
+        }
+        catch (const std::exception &e)
+        {
+            // the corrupted file is rebuilt in memory
+            helpers::logMessage(e.what());
+        }
+    }
+    return std::make_shared<const Factorization>(y, x);
+}
+
+void FactorizationCache::evict()
+{
+    while (used > limit && !uses.empty())
+    {
+        auto it = entries.find(uses.back());
+        used -= it->second.value->memoryUsage();
+        entries.erase(it);
+        uses.pop_back();
+    }
+}
@@ -0,0 +1,191 @@
+#include "FactorizationStore.h"
+#include "Instrumentation.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SECRET_BOX_MMAP 1
+#endif
+
+namespace SecureBoxHack
+{
+namespace store
+{
+namespace
+{
+using Word = BitMatrix::Word;
+
+constexpr char magic[8] = {'S', 'B', 'O', 'X', 'F', 'A', 'C', 'T'};
+
+/// @brief The file header taking a whole cache line,
+/// so the rows following it keep the BitMatrix alignment
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t wordBytes;
+    uint32_t height, width;
+    uint64_t rank;
+    uint64_t stride;
+    uint64_t checksum;
+    uint8_t reserved[16];
+};
+static_assert(sizeof(Header) == BitMatrix::alignment);
+
+/// @brief FNV-1a hash of the words
+uint64_t hashWords(uint64_t hash, const Word *words, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; i++)
+        hash = (hash ^ words[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+/// @brief Returns the checksum of the header fields and the rows
+uint64_t checksum(const Header &header, const Word *rows, std::size_t count)
+{
+    const Word fields[] = {header.height, header.width, header.rank,
+                           header.stride};
+    const uint64_t hash = hashWords(0xcbf29ce484222325ull, fields, 4);
+    return hashWords(hash, rows, count);
+}
+
+/// @brief Returns the number of the rows words following the header
+std::size_t payloadWords(const Header &header)
+{
+    const std::size_t n = std::size_t{header.height} * header.width;
+    return (2 * n - header.rank) * header.stride;
+}
+
+/// @brief Checks that the header describes the factorization of the format
+/// and fits into the file
+void validate(const Header &header, std::size_t fileBytes)
+{
+    const std::size_t n = std::size_t{header.height} * header.width;
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+        throw std::runtime_error("Not a factorization file");
+    if (header.version != formatVersion)
+        throw std::runtime_error("Unsupported factorization file version " +
+                                 std::to_string(header.version));
+    if (header.wordBytes != sizeof(Word) || header.rank > n ||
+        header.stride != BitMatrix::strideFor(n))
+        throw std::runtime_error("Factorization file layout mismatch");
+    if (fileBytes != sizeof(Header) + payloadWords(header) * sizeof(Word))
+        throw std::runtime_error("Factorization file size mismatch");
+}
+
+/// @brief Builds the factorization viewing the rows of the storage
+std::shared_ptr<const Factorization> adopt(const Header &header,
+                                           const Word *rows,
+                                           std::shared_ptr<const void> storage)
+{
+    const std::size_t n = std::size_t{header.height} * header.width;
+    BitMatrix inverse(rows, n, n);
+    BitMatrix nullBasis(rows + n * header.stride, n - header.rank, n);
+    return std::make_shared<const Factorization>(header.height,
+                                                 header.width,
+                                                 std::move(inverse),
+                                                 std::move(nullBasis),
+                                                 std::move(storage));
+}
+} // namespace
+
+std::filesystem::path fileName(uint32_t y, uint32_t x)
+{
+    return "factorization_" + std::to_string(y) + "x" + std::to_string(x) +
+           ".sbf";
+}
+
+void save(const Factorization &factorization,
+          const std::filesystem::path &path)
+{
+    const BitMatrix &inverse = factorization.pseudoInverse();
+    const BitMatrix &nullBasis = factorization.nullSpace();
+
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = formatVersion;
+    header.wordBytes = sizeof(Word);
+    header.height = factorization.height();
+    header.width = factorization.width();
+    header.rank = factorization.rank();
+    header.stride = inverse.rowStride();
+
+    // the rows are hashed in the file order
+    uint64_t hash = checksum(header, nullptr, 0);
+    for (const auto *matrix : {&inverse, &nullBasis})
+        for (auto row : *matrix)
+            hash = hashWords(hash, row.data(), row.wordCount());
+    header.checksum = hash;
+
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (const auto *matrix : {&inverse, &nullBasis})
+            for (auto row : *matrix)
+                file.write(reinterpret_cast<const char *>(row.data()),
+                           static_cast<std::streamsize>(row.wordCount() *
+                                                        sizeof(Word)));
+        if (!file.flush())
+            throw std::runtime_error("Can't write " + temporary.string());
+    }
+    std::filesystem::rename(temporary, path);
+}
+
+std::shared_ptr<const Factorization> load(const std::filesystem::path &path,
+                                          bool verify)
+{
+    const std::size_t fileBytes = std::filesystem::file_size(path);
+    if (fileBytes < sizeof(Header))
+        throw std::runtime_error("Not a factorization file");
+
+    std::shared_ptr<const void> storage;
+    const Word *words = nullptr;
+#if defined(SECRET_BOX_MMAP)
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Can't open " + path.string());
+    void *memory =
+        mmap(nullptr, fileBytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+        throw std::runtime_error("Can't map " + path.string());
+    storage = std::shared_ptr<const void>(
+        memory, [fileBytes](const void *mapped) {
+            munmap(const_cast<void *>(mapped), fileBytes);
+        });
+    words = static_cast<const Word *>(memory);
+#else
+    // without the memory mapping the file is read into the aligned storage
+    auto buffer = std::make_shared<BitMatrix>(
+        1, fileBytes * 8 + BitMatrix::alignment * 8);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read(reinterpret_cast<char *>(buffer->rowData(0)),
+                   static_cast<std::streamsize>(fileBytes)))
+        throw std::runtime_error("Can't read " + path.string());
+    words = buffer->rowData(0);
+    storage = std::move(buffer);
+#endif
+
+    Header header;
+    std::memcpy(&header, words, sizeof(header));
+    validate(header, fileBytes);
+
+    const Word *rows = words + sizeof(Header) / sizeof(Word);
+    if (verify && checksum(header, rows, payloadWords(header)) !=
+                      header.checksum)
+        throw std::runtime_error("Factorization file checksum mismatch");
+
+    auto factorization = adopt(header, rows, std::move(storage));
+    instrumentation::count(instrumentation::Counter::StoreLoads);
+    return factorization;
+}
+} // namespace store
+} // namespace SecureBoxHack
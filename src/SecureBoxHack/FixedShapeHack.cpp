@@ -0,0 +1,108 @@
+#include "FixedShapeHack.h"
+#include "helpers.h"
+#include <stdexcept>
+#include <utility>
+
+namespace SecureBoxHack
+{
+namespace fixed
+{
+namespace
+{
+/// @brief The solvers of the shapes up to limit x limit, the shape
+/// (y, x) has the index (y - 1) * limit + x - 1. Every solver builds
+/// its tables at compile time of this file only
+template <std::size_t... I>
+constexpr auto makeSolvers(std::index_sequence<I...>)
+{
+    return std::array<Solver, sizeof...(I)>{
+        &FixedHack<I / shapeLimit + 1, I % shapeLimit + 1>::solve...};
+}
+
+constexpr auto solvers =
+    makeSolvers(std::make_index_sequence<shapeLimit * shapeLimit>());
+} // namespace
+
+Solver findSolver(std::size_t y, std::size_t x)
+{
+    if (y == 0 || x == 0 || y > shapeLimit || x > shapeLimit)
+        return nullptr;
+    return solvers[(y - 1) * shapeLimit + x - 1];
+}
+} // namespace fixed
+
+namespace
+{
+/// @brief Copies the words of the box cells from the packed state
+std::vector<uint64_t> copyBitmap(std::span<const uint64_t> packedState,
+                                 std::size_t y,
+                                 std::size_t x)
+{
+    const std::size_t words = (y * x + 63) / 64;
+    if (packedState.size() < words)
+        throw std::invalid_argument("FixedShapeHack packed state is too short");
+    return {packedState.begin(),
+            packedState.begin() + static_cast<std::ptrdiff_t>(words)};
+}
+} // namespace
+
+FixedShapeHack::FixedShapeHack(const BoolMatrix &initialState,
+                               EliminationEngine fallback)
+    : y(static_cast<uint32_t>(initialState.size())),
+      x(static_cast<uint32_t>(helpers::stateWidth(initialState))),
+      packed(helpers::packState(initialState)), engine(fallback),
+      solvable(true)
+{
+}
+
+FixedShapeHack::FixedShapeHack(std::span<const uint64_t> packedState,
+                               uint32_t height,
+                               uint32_t width,
+                               EliminationEngine fallback)
+    : y(height), x(width), packed(copyBitmap(packedState, y, x)),
+      engine(fallback), solvable(true)
+{
+}
+
+ToggleSequence FixedShapeHack::getUnlockSequence()
+{
+    const auto solver = fixed::findSolver(y, x);
+    if (!solver)
+    {
+        BoxHack hack(packed, y, x, engine);
+        auto togglCells = hack.getUnlockSequence();
+        solvable = hack.isSolvable();
+        return togglCells;
+    }
+
+    fixed::MaxBitset toggles;
+    ToggleSequence togglCells;
+    solvable = solver(packed, toggles);
+    if (!solvable)
+    {
+        helpers::logMessage("The state can't be unlocked");
+        return togglCells;
+    }
+
+    for (std::size_t w = 0; w < packed.size(); w++)
+        for (uint64_t word = toggles[w]; word; word &= word - 1)
+            togglCells.push_back(helpers::toCartesianCoordinates(
+                w * 64 + static_cast<std::size_t>(std::countr_zero(word)), x));
+
+    helpers::logFormat(helpers::LogLevel::INFO,
+                       "Solution found. Requires %zu toggles",
+                       togglCells.size());
+
+    return togglCells;
+}
+
+bool FixedShapeHack::isSolvable() const
+{
+    return solvable;
+}
+
+bool FixedShapeHack::isSpecialized(std::size_t height, std::size_t width)
+{
+    return fixed::findSolver(height, width) != nullptr;
+}
+} // namespace SecureBoxHack
@@ -0,0 +1,129 @@
+#include "FourRussians.h"
+#include "Cancellation.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <bit>
+
+namespace SecureBoxHack
+{
+namespace elimination
+{
+namespace
+{
+/// @brief Fills the Gray code table with all the combinations of the rows.
+/// The entry with the index i is the XOR of the rows selected by bits of i
+/// @param table The table with at least 2^rows.size() entries.
+/// The zero entry is expected to be empty
+/// @param m The Gauss matrix
+/// @param rows Indices of the rows to be combined
+void fillGrayTable(GaussMatrix &table, const GaussMatrix &m,
+                   const std::vector<std::size_t> &rows)
+{
+    const std::size_t size = static_cast<std::size_t>(1) << rows.size();
+    // the neighbour gray codes differ in one bit only, so every entry
+    // costs a single row XOR
+    for (std::size_t i = 1; i < size; i++)
+    {
+        const std::size_t code = i ^ (i >> 1);
+        const std::size_t prev = (i - 1) ^ ((i - 1) >> 1);
+        table[code].assign(table[prev]);
+        table[code] ^= m[rows[static_cast<std::size_t>(std::countr_zero(i))]];
+    }
+}
+} // namespace
+
+std::vector<std::size_t> reduceFourRussians(GaussMatrix &m,
+                                            std::size_t columns,
+                                            bool reduced,
+                                            std::size_t k)
+{
+    const std::size_t n = m.size();
+    GaussMatrix table(static_cast<std::size_t>(1) << k, m.columns());
+    // pivot columns of the rows [0, rank)
+    std::vector<std::size_t> pivotCols;
+    // pivot rows and columns of the current strip
+    std::vector<std::size_t> stripRows, stripCols;
+    uint64_t xors = 0;
+
+    for (std::size_t c = 0; c < columns && pivotCols.size() < n; c += k)
+    {
+        cancellation::checkpoint();
+        const std::size_t stripStart = pivotCols.size();
+        stripRows.clear();
+        stripCols.clear();
+
+        for (std::size_t col = c; col < std::min(c + k, columns); col++)
+        {
+            std::size_t j = pivotCols.size();
+            for (; j < n; j++)
+            {
+                // the rows are cleared lazily, so reduce the candidate
+                // by the pivots found in the strip so far
+                for (std::size_t p = 0; p < stripRows.size(); p++)
+                    if (m[j].test(stripCols[p]))
+                    {
+                        m[j] ^= m[stripRows[p]];
+                        xors++;
+                    }
+                if (m[j].test(col))
+                    break;
+            }
+            if (j == n)
+                continue; // the column has no pivot
+
+            const std::size_t r = pivotCols.size();
+            if (j != r)
+                m.swapRows(r, j);
+            // keep the strip pivots reduced against each other
+            for (std::size_t p : stripRows)
+                if (m[p].test(col))
+                {
+                    m[p] ^= m[r];
+                    xors++;
+                }
+
+            stripRows.push_back(r);
+            stripCols.push_back(col);
+            pivotCols.push_back(col);
+        }
+
+        if (stripRows.empty())
+            continue;
+
+        fillGrayTable(table, m, stripRows);
+        xors += (std::size_t{1} << stripRows.size()) - 1;
+        // the rows above the strip are cleared only for the reduced form
+        for (std::size_t j = reduced ? 0 : pivotCols.size(); j < n; j++)
+        {
+            if (j == stripStart)
+                j = pivotCols.size(); // skip the strip pivots
+            if (j == n)
+                break;
+
+            std::size_t mask = 0;
+            for (std::size_t p = 0; p < stripCols.size(); p++)
+                mask |= static_cast<std::size_t>(m[j].test(stripCols[p])) << p;
+            if (mask)
+            {
+                m[j] ^= table[mask];
+                xors++;
+            }
+        }
+    }
+    instrumentation::countRowXors(xors, m.rowStride());
+    return pivotCols;
+}
+
+void echelonFourRussians(GaussMatrix &m, std::size_t k)
+{
+    const auto pivotCols = reduceFourRussians(m, m.size(), false, k);
+
+    // Move every pivot row into the row with the index of its column.
+    // The rows starting from the rank have no coefficients left,
+    // so they fill the gaps of the columns without the pivot
+    for (std::size_t r = pivotCols.size(); r-- > 0;)
+        if (pivotCols[r] != r)
+            m.swapRows(r, pivotCols[r]);
+}
+} // namespace elimination
+} // namespace SecureBoxHack
@@ -0,0 +1,159 @@
+#include "IncrementalHack.h"
+#include "helpers.h"
+#include <algorithm>
+#include <bit>
+
+using namespace SecureBoxHack;
+
+IncrementalHack::IncrementalHack(uint32_t height, uint32_t width)
+    : y(height), x(width), cells(height, width), toggles(height, width),
+      ones(1, width), colToggles(1, width), rowParity(height),
+      colParity(width), oddRows(0), oddCols(0), stale(false)
+{
+    for (std::size_t j = 0; j < x; j++)
+        ones[0].set(j);
+}
+
+IncrementalHack::IncrementalHack(const BoolMatrix &initialState)
+    : IncrementalHack(static_cast<uint32_t>(initialState.size()),
+                      static_cast<uint32_t>(helpers::stateWidth(initialState)))
+{
+    for (uint32_t i = 0; i < y; i++)
+        for (uint32_t j = 0; j < x; j++)
+            if (initialState[i][j])
+                flip(i, j);
+}
+
+IncrementalHack::IncrementalHack(std::span<const uint64_t> packedState,
+                                 uint32_t height,
+                                 uint32_t width)
+    : IncrementalHack(height, width)
+{
+    flip(packedState);
+}
+
+void IncrementalHack::flip(uint32_t posY, uint32_t posX)
+{
+    cells[posY].set(posX, !cells[posY].test(posX));
+
+    const bool row = !rowParity.test(posY), col = !colParity.test(posX);
+    rowParity.set(posY, row);
+    colParity.set(posX, col);
+    oddRows = row ? oddRows + 1 : oddRows - 1;
+    oddCols = col ? oddCols + 1 : oddCols - 1;
+    stale = true;
+}
+
+void IncrementalHack::flip(const ToggleSequence &flips)
+{
+    for (auto [posY, posX] : flips)
+        flip(posY, posX);
+}
+
+void IncrementalHack::flip(std::span<const uint64_t> packedChanges)
+{
+    const std::size_t n = std::size_t{y} * x;
+    const std::size_t words = std::min(packedChanges.size(), (n + 63) / 64);
+    for (std::size_t w = 0; w < words; w++)
+        for (uint64_t word = packedChanges[w]; word; word &= word - 1)
+        {
+            const std::size_t k =
+                w * 64 + static_cast<std::size_t>(std::countr_zero(word));
+            if (k >= n)
+                return;
+            flip(static_cast<uint32_t>(k / x), static_cast<uint32_t>(k % x));
+        }
+}
+
+bool IncrementalHack::isSolvable() const
+{
+    // the odd dimension requires the parities of the lines along it
+    // to be equal, see StructuredHack::isSolvable()
+    if (x % 2 && oddRows != 0 && oddRows != y)
+        return false;
+    if (y % 2 && oddCols != 0 && oddCols != x)
+        return false;
+    return true;
+}
+
+bool IncrementalHack::totalToggles() const
+{
+    if (x % 2)
+        return rowParity.test(0);
+    if (y % 2)
+        return colParity.test(0);
+    // both dimensions are even: T equals to the parity of the whole state
+    return oddRows % 2;
+}
+
+const BitMatrix &IncrementalHack::solution()
+{
+    if (!stale)
+        return toggles;
+    stale = false;
+
+    if (!isSolvable())
+    {
+        toggles.reset();
+        return toggles;
+    }
+
+    // the odd dimension puts all the line toggles into the first line,
+    // the same way StructuredHack::solveParities() does
+    const bool total = totalToggles();
+    for (std::size_t j = 0; j < x; j++)
+        colToggles[0].set(j, y % 2 ? j == 0 && total
+                                   : colParity.test(j) ^ total);
+
+    for (std::size_t i = 0; i < y; i++)
+    {
+        const bool rowToggle =
+            x % 2 ? i == 0 && total : rowParity.test(i) ^ total;
+        BitRow row = toggles[i];
+        row.assign(cells[i]);
+        row ^= colToggles[0];
+        if (rowToggle)
+            row ^= ones[0];
+    }
+    return toggles;
+}
+
+ToggleSequence IncrementalHack::getUnlockSequence()
+{
+    ToggleSequence togglCells;
+    if (!isSolvable())
+    {
+        helpers::logMessage("The state can't be unlocked");
+        return togglCells;
+    }
+
+    const BitMatrix &t = solution();
+    for (std::size_t i = 0; i < y; i++)
+    {
+        const ConstBitRow row = t[i];
+        for (std::size_t j = row.findFirst(); j < x; j = row.findFirst(j + 1))
+            togglCells.emplace_back(static_cast<uint32_t>(i),
+                                    static_cast<uint32_t>(j));
+    }
+
+    helpers::logFormat(helpers::LogLevel::INFO,
+                       "Solution found. Requires %zu toggles",
+                       togglCells.size());
+
+    return togglCells;
+}
+
+bool IncrementalHack::test(uint32_t posY, uint32_t posX) const
+{
+    return cells[posY].test(posX);
+}
+
+uint32_t IncrementalHack::height() const
+{
+    return y;
+}
+
+uint32_t IncrementalHack::width() const
+{
+    return x;
+}
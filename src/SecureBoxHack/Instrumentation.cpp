@@ -0,0 +1,273 @@
+#include "Instrumentation.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace SecureBoxHack
+{
+namespace instrumentation
+{
+namespace
+{
+const char *const phaseNames[] = {
+    "build_gauss_matrix", "elimination", "back_substitution", "minimization"};
+const char *const counterNames[] = {"solves",
+                                    "pivots",
+                                    "free_variables",
+                                    "row_xors",
+                                    "words_touched",
+                                    "bytes_allocated",
+                                    "early_rejects",
+                                    "store_loads"};
+static_assert(std::size(phaseNames) == phaseCount);
+static_assert(std::size(counterNames) == counterCount);
+
+double toSeconds(uint64_t nanoseconds)
+{
+    return static_cast<double>(nanoseconds) * 1e-9;
+}
+
+#if SECURE_BOX_INSTRUMENTATION
+using Cell = std::atomic<uint64_t>;
+
+/// @brief The counters and the histograms of a single thread.
+/// Only the owner thread writes them, so the increments are the relaxed
+/// loads and stores instead of the locked read-modify-write
+struct Local
+{
+    std::array<Cell, counterCount> counters{};
+    std::array<std::array<Cell, Histogram::bucketCount>, phaseCount>
+        buckets{};
+    std::array<Cell, phaseCount> counts{};
+    std::array<Cell, phaseCount> sums{};
+
+    Local();
+    ~Local();
+    Local(const Local &) = delete;
+    Local &operator=(const Local &) = delete;
+};
+
+/// @brief The blocks of the running threads and the totals of the exited
+/// ones. The mutex is taken by the thread start and exit and by the
+/// snapshots only
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<const Local *> locals;
+    Snapshot retired;
+    // the totals at the last reset(), subtracted from the snapshots
+    Snapshot base;
+
+    Registry() : mutex(), locals(), retired(), base()
+    {
+    }
+};
+
+Registry &registry()
+{
+    // never destroyed, the thread-local blocks may outlive the statics
+    static auto *instance = new Registry();
+    return *instance;
+}
+
+void add(Cell &cell, uint64_t value)
+{
+    cell.store(cell.load(std::memory_order_relaxed) + value,
+               std::memory_order_relaxed);
+}
+
+uint64_t read(const Cell &cell)
+{
+    return cell.load(std::memory_order_relaxed);
+}
+
+void addTo(Snapshot &total, const Local &local)
+{
+    for (std::size_t c = 0; c < counterCount; c++)
+        total.counters[c] += read(local.counters[c]);
+    for (std::size_t p = 0; p < phaseCount; p++)
+    {
+        auto &phase = total.phases[p];
+        for (std::size_t b = 0; b < Histogram::bucketCount; b++)
+            phase.buckets[b] += read(local.buckets[p][b]);
+        phase.count += read(local.counts[p]);
+        phase.sumNanoseconds += read(local.sums[p]);
+    }
+}
+
+/// @brief Sums the blocks, the registry mutex is expected to be locked
+Snapshot totals(const Registry &r)
+{
+    Snapshot total = r.retired;
+    for (const Local *local : r.locals)
+        addTo(total, *local);
+    return total;
+}
+
+Local::Local()
+{
+    auto &r = registry();
+    std::lock_guard lock(r.mutex);
+    r.locals.push_back(this);
+}
+
+Local::~Local()
+{
+    auto &r = registry();
+    std::lock_guard lock(r.mutex);
+    addTo(r.retired, *this);
+    r.locals.erase(std::find(r.locals.begin(), r.locals.end(), this));
+}
+
+Local &local()
+{
+    thread_local Local instance;
+    return instance;
+}
+
+// the nesting depth of the Suppression scopes of the thread
+thread_local unsigned suppressed = 0;
+#endif
+} // namespace
+
+std::size_t Histogram::bucketOf(uint64_t nanoseconds)
+{
+    const auto width =
+        static_cast<std::size_t>(std::bit_width(nanoseconds / 1000));
+    return std::min(width, bucketCount - 1);
+}
+
+const char *phaseName(Phase phase)
+{
+    return phaseNames[static_cast<std::size_t>(phase)];
+}
+
+const char *counterName(Counter counter)
+{
+    return counterNames[static_cast<std::size_t>(counter)];
+}
+
+std::string toJson(const Snapshot &snapshot)
+{
+    std::ostringstream os;
+    os << "{\"counters\":{";
+    for (std::size_t c = 0; c < counterCount; c++)
+        os << (c ? "," : "") << '"' << counterNames[c]
+           << "\":" << snapshot.counters[c];
+    os << "},\"phases\":{";
+    for (std::size_t p = 0; p < phaseCount; p++)
+    {
+        const auto &phase = snapshot.phases[p];
+        os << (p ? "," : "") << '"' << phaseNames[p]
+           << "\":{\"count\":" << phase.count
+           << ",\"sum_seconds\":" << toSeconds(phase.sumNanoseconds)
+           << ",\"buckets\":[";
+        for (std::size_t b = 0; b < Histogram::bucketCount; b++)
+            os << (b ? "," : "") << phase.buckets[b];
+        os << "]}";
+    }
+    os << "}}";
+    return os.str();
+}
+
+std::string toPrometheus(const Snapshot &snapshot)
+{
+    std::ostringstream os;
+    for (std::size_t c = 0; c < counterCount; c++)
+        os << "# TYPE secret_box_" << counterNames[c] << "_total counter\n"
+           << "secret_box_" << counterNames[c] << "_total "
+           << snapshot.counters[c] << "\n";
+
+    os << "# TYPE secret_box_phase_seconds histogram\n";
+    for (std::size_t p = 0; p < phaseCount; p++)
+    {
+        const auto &phase = snapshot.phases[p];
+        const std::string label =
+            std::string("{phase=\"") + phaseNames[p] + "\"";
+        // the Prometheus buckets are cumulative
+        uint64_t cumulative = 0;
+        for (std::size_t b = 0; b + 1 < Histogram::bucketCount; b++)
+        {
+            cumulative += phase.buckets[b];
+            os << "secret_box_phase_seconds_bucket" << label << ",le=\""
+               << toSeconds(uint64_t{1000} << b) << "\"} " << cumulative
+               << "\n";
+        }
+        os << "secret_box_phase_seconds_bucket" << label << ",le=\"+Inf\"} "
+           << phase.count << "\n"
+           << "secret_box_phase_seconds_sum" << label << "} "
+           << toSeconds(phase.sumNanoseconds) << "\n"
+           << "secret_box_phase_seconds_count" << label << "} "
+           << phase.count << "\n";
+    }
+    return os.str();
+}
+
+#if SECURE_BOX_INSTRUMENTATION
+void count(Counter counter, uint64_t value)
+{
+    if (suppressed)
+        return;
+    add(local().counters[static_cast<std::size_t>(counter)], value);
+}
+
+void record(Phase phase, std::chrono::nanoseconds duration)
+{
+    if (suppressed)
+        return;
+    const auto p = static_cast<std::size_t>(phase);
+    const auto nanoseconds = static_cast<uint64_t>(duration.count());
+    auto &block = local();
+    add(block.buckets[p][Histogram::bucketOf(nanoseconds)], 1);
+    add(block.counts[p], 1);
+    add(block.sums[p], nanoseconds);
+}
+
+Snapshot snapshot()
+{
+    auto &r = registry();
+    std::lock_guard lock(r.mutex);
+    Snapshot total = totals(r);
+    for (std::size_t c = 0; c < counterCount; c++)
+        total.counters[c] -= r.base.counters[c];
+    for (std::size_t p = 0; p < phaseCount; p++)
+    {
+        auto &phase = total.phases[p];
+        const auto &base = r.base.phases[p];
+        for (std::size_t b = 0; b < Histogram::bucketCount; b++)
+            phase.buckets[b] -= base.buckets[b];
+        phase.count -= base.count;
+        phase.sumNanoseconds -= base.sumNanoseconds;
+    }
+    return total;
+}
+
+void reset()
+{
+    // the blocks are written by their owners only, so the current totals
+    // are remembered and subtracted instead of clearing the blocks
+    auto &r = registry();
+    std::lock_guard lock(r.mutex);
+    r.base = totals(r);
+}
+
+bool recording()
+{
+    return !suppressed;
+}
+
+Suppression::Suppression()
+{
+    suppressed++;
+}
+
+Suppression::~Suppression()
+{
+    suppressed--;
+}
+#endif
+} // namespace instrumentation
+} // namespace SecureBoxHack
@@ -0,0 +1,77 @@
+#include "LanczosHack.h"
+#include "helpers.h"
+
+using namespace SecureBoxHack;
+
+LanczosHack::LanczosHack(const BoolMatrix &initialState,
+                         uint64_t randomSeed)
+    : y(initialState.size()), x(initialState[0].size()), state(y * x),
+      seed(randomSeed), result(lanczos::Outcome::Failed)
+{
+    for (std::size_t i = 0; i < y; i++)
+        for (std::size_t j = 0; j < x; j++)
+            state.set(i * x + j, initialState[i][j]);
+}
+
+ToggleSequence LanczosHack::getUnlockSequence()
+{
+    DynamicBitset solution(y * x);
+    result = lanczos::solve(
+        [this](const lanczos::Block &in, lanczos::Block &out) {
+            applyToggles(y, x, in, out);
+        },
+        state,
+        solution,
+        seed);
+
+    ToggleSequence togglCells;
+    if (result == lanczos::Outcome::Unsolvable)
+    {
+        helpers::logMessage("The state can't be unlocked");
+        return togglCells;
+    }
+    if (result == lanczos::Outcome::Failed)
+    {
+        helpers::logMessage("The solver didn't converge");
+        return togglCells;
+    }
+
+    for (std::size_t i = solution.findFirst(); i < y * x;
+         i = solution.findFirst(i + 1))
+        togglCells.push_back(helpers::toCartesianCoordinates(i, x));
+
+    helpers::logFormat(helpers::LogLevel::INFO,
+                       "Solution found. Requires %zu toggles",
+                       togglCells.size());
+
+    return togglCells;
+}
+
+lanczos::Outcome LanczosHack::outcome() const
+{
+    return result;
+}
+
+void LanczosHack::applyToggles(std::size_t y,
+                               std::size_t x,
+                               const lanczos::Block &in,
+                               lanczos::Block &out)
+{
+    lanczos::Block cols(x, 0);
+    for (std::size_t i = 0; i < y; i++)
+    {
+        const auto *row = in.data() + i * x;
+        kernels::xorWords(cols.data(), row, x);
+    }
+
+    for (std::size_t i = 0; i < y; i++)
+    {
+        const auto *row = in.data() + i * x;
+        kernels::Word rowSum = 0;
+        for (std::size_t j = 0; j < x; j++)
+            rowSum ^= row[j];
+        // the cell itself is flipped once, not by both its row and column
+        for (std::size_t j = 0; j < x; j++)
+            out[i * x + j] = rowSum ^ cols[j] ^ row[j];
+    }
+}
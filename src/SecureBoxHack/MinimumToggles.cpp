@@ -0,0 +1,100 @@
+#include "MinimumToggles.h"
+#include <bit>
+
+namespace SecureBoxHack
+{
+namespace minimization
+{
+namespace
+{
+/// @brief Returns the weight of the XOR of the rows without storing it
+std::size_t weightXor(ConstBitRow a, ConstBitRow b)
+{
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < a.wordCount(); i++)
+        count += static_cast<std::size_t>(
+            std::popcount(a.data()[i] ^ b.data()[i]));
+    return count;
+}
+
+std::size_t searchExhaustive(BitRow solution, const BitMatrix &nullBasis)
+{
+    BitMatrix current(1, solution.size());
+    current[0].assign(solution);
+
+    std::size_t best = weight(solution);
+    std::size_t bestCode = 0;
+    const std::size_t size = std::size_t{1} << nullBasis.size();
+    for (std::size_t i = 1; i < size; i++)
+    {
+        current[0] ^= nullBasis[static_cast<std::size_t>(std::countr_zero(i))];
+        if (const std::size_t w = weight(current[0]); w < best)
+        {
+            best = w;
+            bestCode = i ^ (i >> 1);
+        }
+    }
+
+    for (std::size_t k = 0; k < nullBasis.size(); k++)
+        if (bestCode >> k & 1)
+            solution ^= nullBasis[k];
+    return best;
+}
+
+std::size_t searchGreedy(BitRow solution, const BitMatrix &nullBasis)
+{
+    std::size_t best = weight(solution);
+    for (bool improved = true; improved;)
+    {
+        improved = false;
+        for (std::size_t k = 0; k < nullBasis.size(); k++)
+            if (const std::size_t w = weightXor(solution, nullBasis[k]);
+                w < best)
+            {
+                solution ^= nullBasis[k];
+                best = w;
+                improved = true;
+            }
+        if (improved)
+            continue;
+
+        // the single rows are exhausted, try the pairs of them
+        BitMatrix pair(1, solution.size());
+        for (std::size_t k = 0; k < nullBasis.size() && !improved; k++)
+        {
+            pair[0].assign(solution);
+            pair[0] ^= nullBasis[k];
+            for (std::size_t l = k + 1; l < nullBasis.size(); l++)
+                if (const std::size_t w = weightXor(pair[0], nullBasis[l]);
+                    w < best)
+                {
+                    solution ^= nullBasis[k];
+                    solution ^= nullBasis[l];
+                    best = w;
+                    improved = true;
+                    break;
+                }
+        }
+    }
+    return best;
+}
+} // namespace
+
+std::size_t weight(ConstBitRow row)
+{
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < row.wordCount(); i++)
+        count += static_cast<std::size_t>(std::popcount(row.data()[i]));
+    return count;
+}
+
+std::size_t minimizeToggles(BitRow solution,
+                            const BitMatrix &nullBasis,
+                            std::size_t exhaustiveLimit)
+{
+    if (nullBasis.size() <= exhaustiveLimit)
+        return searchExhaustive(solution, nullBasis);
+    return searchGreedy(solution, nullBasis);
+}
+} // namespace minimization
+} // namespace SecureBoxHack
@@ -0,0 +1,186 @@
+#include "NaiveElimination.h"
+#include "Cancellation.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <bit>
+
+namespace SecureBoxHack
+{
+namespace elimination
+{
+namespace
+{
+using kernels::Word;
+constexpr std::size_t wordBits = sizeof(Word) * 8;
+
+/// @brief The elimination probing the pivot column row by row
+void echelonRows(GaussMatrix &m)
+{
+    uint64_t xors = 0;
+    for (std::size_t i = 0, j = 0; i + 1 < m.size(); ++i, j = i)
+    {
+        if (i % cancellation::pivotBlock == 0)
+            cancellation::checkpoint();
+        for (; j < m.size() && !m[j].test(i); j++)
+        { // searching for the row with Xi component equal true
+        }
+        if (j == m.size())
+            continue; // if Xi component is false consider its value in the solution as false
+        if (j != i)
+            m.swapRows(i, j);
+        else
+            j++;
+
+        for (; j < m.size(); j++)
+            if (m[j].test(i))
+            {
+                m[j] ^= m[i];
+                xors++;
+            }
+    }
+    instrumentation::countRowXors(xors, m.rowStride());
+}
+
+/// @brief The elimination scanning the pivot column in the ColumnStrip
+void echelonColumns(GaussMatrix &m)
+{
+    static_assert(ColumnStrip::width == cancellation::pivotBlock);
+    ColumnStrip strip(m.size());
+    uint64_t xors = 0;
+    for (std::size_t i = 0; i + 1 < m.size(); i++)
+    {
+        if (i % ColumnStrip::width == 0)
+        {
+            cancellation::checkpoint();
+            strip.load(m, i);
+        }
+        const std::size_t j = strip.findRow(i, i);
+        if (j == m.size())
+            continue; // if Xi component is false consider its value in the solution as false
+        if (j != i)
+        {
+            m.swapRows(i, j);
+            strip.swapRows(i, j);
+        }
+
+        // the rows below the pivot with the bit, word by word
+        const Word *below = strip.column(i).data();
+        for (std::size_t w = (i + 1) / wordBits; w * wordBits < m.size(); w++)
+            for (Word bits = w == (i + 1) / wordBits
+                                 ? below[w] & (~Word{0} << (i + 1) % wordBits)
+                                 : below[w];
+                 bits;
+                 bits &= bits - 1)
+            {
+                m[w * wordBits + static_cast<std::size_t>(
+                                     std::countr_zero(bits))] ^= m[i];
+                xors++;
+            }
+        strip.eliminate(i, m.rowData(i)[i / wordBits]);
+    }
+    instrumentation::countRowXors(xors, m.rowStride());
+}
+} // namespace
+
+ColumnStrip::ColumnStrip(std::size_t rowsCount)
+    : rows(rowsCount), words((rowsCount + wordBits - 1) / wordBits), first(0),
+      columns(width * words)
+{
+}
+
+void ColumnStrip::load(const GaussMatrix &m, std::size_t firstColumn)
+{
+    first = firstColumn;
+    const std::size_t w = first / wordBits;
+    Word block[width];
+    for (std::size_t g = 0; g < words; g++)
+    {
+        // the rows of the block past the matrix are zero
+        for (std::size_t k = 0; k < width; k++)
+        {
+            const std::size_t row = g * wordBits + k;
+            block[k] = row < rows ? m.rowData(row)[w] : 0;
+        }
+        kernels::transpose64(block);
+        for (std::size_t c = 0; c < width; c++)
+            columns[c * words + g] = block[c];
+    }
+}
+
+ConstBitRow ColumnStrip::column(std::size_t c) const
+{
+    return {columnData(c), rows, words};
+}
+
+std::size_t ColumnStrip::findRow(std::size_t c, std::size_t from) const
+{
+    if (from >= rows)
+        return rows;
+    // the columns are a few words long, so they are scanned in place
+    // instead of calling the kernel
+    const Word *column = columnData(c);
+    std::size_t w = from / wordBits;
+    for (Word bits = column[w] & (~Word{0} << from % wordBits);;
+         bits = column[w])
+    {
+        if (bits)
+            return w * wordBits +
+                   static_cast<std::size_t>(std::countr_zero(bits));
+        // the bits past the rows are zero
+        if (++w == words)
+            return rows;
+    }
+}
+
+void ColumnStrip::swapRows(std::size_t i, std::size_t j)
+{
+    const Word bitI = Word{1} << (i % wordBits);
+    const Word bitJ = Word{1} << (j % wordBits);
+    for (std::size_t c = 0; c < width; c++)
+    {
+        Word *column = columns.data() + c * words;
+        const bool atI = column[i / wordBits] & bitI;
+        if (atI != static_cast<bool>(column[j / wordBits] & bitJ))
+        {
+            column[i / wordBits] ^= bitI;
+            column[j / wordBits] ^= bitJ;
+        }
+    }
+}
+
+void ColumnStrip::eliminate(std::size_t pivot, Word pivotWord)
+{
+    const std::size_t below = pivot + 1;
+    if (below >= rows)
+        return;
+
+    // the eliminated rows are the rows below the pivot in its column,
+    // every column of the pivot row right of the pivot flips them
+    Word *eliminated = columnData(pivot);
+    const std::size_t w = below / wordBits;
+    const Word head = eliminated[w] & (~Word{0} << (below % wordBits));
+    const std::size_t offset = pivot % wordBits + 1;
+    for (Word bits = offset < wordBits ? pivotWord >> offset << offset : 0;
+         bits;
+         bits &= bits - 1)
+    {
+        const auto c = static_cast<std::size_t>(std::countr_zero(bits));
+        Word *column = columns.data() + c * words;
+        column[w] ^= head;
+        for (std::size_t k = w + 1; k < words; k++)
+            column[k] ^= eliminated[k];
+    }
+
+    eliminated[w] ^= head;
+    std::fill(eliminated + w + 1, eliminated + words, Word{0});
+}
+
+void echelonNaive(GaussMatrix &m, PivotSearch search)
+{
+    if (search == PivotSearch::Rows)
+        echelonRows(m);
+    else
+        echelonColumns(m);
+}
+} // namespace elimination
+} // namespace SecureBoxHack
@@ -0,0 +1,236 @@
+#include "OutOfCoreElimination.h"
+#include "Cancellation.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace SecureBoxHack
+{
+namespace elimination
+{
+namespace
+{
+using Word = BitMatrix::Word;
+constexpr std::size_t wordBits = sizeof(Word) * 8;
+// the number of the pivots combined by a single Gray code table
+constexpr std::size_t group = 4;
+constexpr std::size_t groupEntries = std::size_t{1} << group;
+
+bool testBit(const Word *words, std::size_t pos)
+{
+    return (words[pos / wordBits] >> (pos % wordBits)) & 1;
+}
+
+/// @brief Advises the kernel to page out the storage rows behind the sweep.
+/// The advice keeps the contents, so it's safe for any storage
+void release(GaussMatrix &m, std::size_t first, std::size_t last)
+{
+#if defined(__linux__) && defined(MADV_COLD)
+    const auto page = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    auto begin = reinterpret_cast<std::uintptr_t>(m.storageRow(first));
+    auto end = reinterpret_cast<std::uintptr_t>(m.storageRow(last));
+    begin = (begin + page - 1) / page * page;
+    end = end / page * page;
+    if (begin < end)
+        madvise(reinterpret_cast<void *>(begin), end - begin, MADV_COLD);
+#else
+    (void)m;
+    (void)first;
+    (void)last;
+#endif
+}
+} // namespace
+
+OutOfCoreStats echelonOutOfCore(GaussMatrix &m, std::size_t budgetBytes)
+{
+    OutOfCoreStats stats;
+    const std::size_t n = m.size();
+    const std::size_t stride = m.rowStride();
+    const std::size_t rowBytes = stride * sizeof(Word);
+    // every pivot takes its row and a quarter of a table
+    const std::size_t perPivot = rowBytes * (1 + groupEntries / group);
+    // the panel never needs more pivots than the columns of the matrix
+    const std::size_t width =
+        std::clamp(budgetBytes / perPivot / group * group,
+                   group,
+                   (n + group - 1) / group * group);
+    const std::size_t chunkRows =
+        std::max<std::size_t>(1, budgetBytes / 2 / rowBytes);
+
+    BitMatrix panel(width, m.columns());
+    BitMatrix tables(width / group * groupEntries, m.columns());
+    std::vector<Word> slice;
+    // whether the storage row is already a pivot
+    std::vector<bool> isPivot(n, false);
+    // the storage rows and the columns of all the pivots
+    std::vector<std::size_t> pivotRows, pivotCols;
+    // the storage rows and the columns of the panel pivots
+    std::vector<std::size_t> rows, cols;
+
+    for (std::size_t c0 = 0; c0 < n && pivotRows.size() < n; c0 += width)
+    {
+        cancellation::checkpoint();
+        const std::size_t c1 = std::min(c0 + width, n);
+        // the rows have no coefficients before the panel, so the words
+        // before its first one are never touched
+        const std::size_t first = c0 / wordBits;
+        const std::size_t sliceWords = (c1 + wordBits - 1) / wordBits - first;
+        const std::size_t tail = stride - first;
+        slice.resize(sliceWords);
+        rows.clear();
+        cols.clear();
+        stats.panels++;
+
+        // the pivot sweep keeps the panel pivots reduced against each other,
+        // so a row is reduced by every pivot independently
+        for (std::size_t p = 0; p < n; p++)
+        {
+            if (p && p % chunkRows == 0)
+                release(m, p - chunkRows, p);
+            if (isPivot[p])
+                continue;
+
+            const Word *row = m.storageRow(p);
+            std::copy(row + first, row + first + sliceWords, slice.begin());
+            stats.bytesRead += sliceWords * sizeof(Word);
+            for (std::size_t q = 0; q < cols.size(); q++)
+                if (testBit(slice.data(), cols[q] - first * wordBits))
+                    kernels::xorWords(slice.data(),
+                                      panel.rowData(q) + first,
+                                      sliceWords);
+
+            const std::size_t pos = kernels::findFirstSet(
+                slice.data(), sliceWords, c0 - first * wordBits);
+            if (pos >= c1 - first * wordBits)
+                continue; // the row is combined from the pivots
+
+            const std::size_t col = first * wordBits + pos;
+            const std::size_t q = cols.size();
+            Word *pivot = panel.rowData(q);
+            std::copy(row + first, row + stride, pivot + first);
+            stats.bytesRead += tail * sizeof(Word);
+            for (std::size_t r = 0; r < q; r++)
+                if (testBit(pivot, cols[r]))
+                    kernels::xorWords(pivot + first,
+                                      panel.rowData(r) + first,
+                                      tail);
+            for (std::size_t r = 0; r < q; r++)
+                if (testBit(panel.rowData(r), col))
+                    kernels::xorWords(panel.rowData(r) + first,
+                                      pivot + first,
+                                      tail);
+
+            rows.push_back(p);
+            cols.push_back(col);
+            isPivot[p] = true;
+        }
+
+        if (cols.empty())
+            continue;
+
+        for (std::size_t q = 0; q < rows.size(); q++)
+        {
+            std::copy(panel.rowData(q) + first,
+                      panel.rowData(q) + stride,
+                      m.storageRow(rows[q]) + first);
+            stats.bytesWritten += tail * sizeof(Word);
+        }
+
+        // the Gray code tables of every group of the pivots, the neighbour
+        // codes differ in one pivot only
+        const std::size_t groups = (cols.size() + group - 1) / group;
+        for (std::size_t g = 0; g < groups; g++)
+        {
+            const std::size_t count = std::min(group, cols.size() - g * group);
+            Word *zero = tables.rowData(g * groupEntries);
+            std::fill(zero + first, zero + stride, Word{0});
+            for (std::size_t i = 1; i < (std::size_t{1} << count); i++)
+            {
+                const std::size_t code = i ^ (i >> 1);
+                const std::size_t prev = (i - 1) ^ ((i - 1) >> 1);
+                Word *entry = tables.rowData(g * groupEntries + code);
+                const Word *from = tables.rowData(g * groupEntries + prev);
+                std::copy(from + first, from + stride, entry + first);
+                kernels::xorWords(
+                    entry + first,
+                    panel.rowData(g * group +
+                                  static_cast<std::size_t>(
+                                      std::countr_zero(i))) +
+                        first,
+                    tail);
+            }
+        }
+
+        // the update sweep. The pivots are reduced, so the table of a group
+        // doesn't change the pivot columns of the other groups
+        for (std::size_t p = 0; p < n; p++)
+        {
+            if (p && p % chunkRows == 0)
+                release(m, p - chunkRows, p);
+            if (isPivot[p])
+                continue;
+
+            Word *row = m.storageRow(p);
+            stats.bytesRead += tail * sizeof(Word);
+            bool changed = false;
+            for (std::size_t g = 0; g < groups; g++)
+            {
+                std::size_t mask = 0;
+                const std::size_t count =
+                    std::min(group, cols.size() - g * group);
+                for (std::size_t b = 0; b < count; b++)
+                    mask |= static_cast<std::size_t>(
+                                testBit(row, cols[g * group + b]))
+                            << b;
+                if (!mask)
+                    continue;
+                kernels::xorWords(row + first,
+                                  tables.rowData(g * groupEntries + mask) +
+                                      first,
+                                  tail);
+                changed = true;
+            }
+            if (changed)
+                stats.bytesWritten += tail * sizeof(Word);
+        }
+
+        pivotRows.insert(pivotRows.end(), rows.begin(), rows.end());
+        pivotCols.insert(pivotCols.end(), cols.begin(), cols.end());
+    }
+
+    // Move every pivot row into the row with the index of its column.
+    // The rows without the pivot have no coefficients left,
+    // so they fill the gaps of the columns without the pivot
+    std::vector<std::size_t> target(n, n);
+    for (std::size_t k = 0; k < pivotRows.size(); k++)
+        target[pivotCols[k]] = pivotRows[k];
+    for (std::size_t i = 0, next = 0; i < n; i++)
+    {
+        if (target[i] != n)
+            continue;
+        while (isPivot[next])
+            next++;
+        target[i] = next++;
+    }
+
+    std::vector<std::size_t> position(n);
+    for (std::size_t i = 0; i < n; i++)
+        position[m.storageIndex(i)] = i;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const std::size_t j = position[target[i]];
+        if (j == i)
+            continue;
+        position[m.storageIndex(i)] = j;
+        position[target[i]] = i;
+        m.swapRows(i, j);
+    }
+    return stats;
+}
+} // namespace elimination
+} // namespace SecureBoxHack
@@ -0,0 +1,69 @@
+#include "ParallelElimination.h"
+#include "Cancellation.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <barrier>
+
+namespace SecureBoxHack
+{
+namespace elimination
+{
+void echelonParallel(GaussMatrix &m, ThreadPool &pool)
+{
+    const std::size_t n = m.size();
+    const std::size_t rowBytes = m.rowStride() * sizeof(BitMatrix::Word);
+    const std::size_t blockRows =
+        std::max<std::size_t>(1, parallelBlockBytes / rowBytes);
+    std::barrier sync(static_cast<std::ptrdiff_t>(pool.size()));
+    // the row with Xi component equal true, n if there is no such row
+    std::size_t pivot = n;
+    // set by the first participant, which runs on the calling thread
+    // and sees its stop condition
+    bool stop = false;
+
+    // the workers don't see the Suppression of the calling thread
+    const bool counted = instrumentation::recording();
+    pool.run([&](std::size_t worker, std::size_t workers) {
+        // every participant counts into its own thread counters
+        uint64_t xors = 0;
+        for (std::size_t i = 0; i + 1 < n; i++)
+        {
+            if (worker == 0)
+            {
+                stop = i % cancellation::pivotBlock == 0 &&
+                       cancellation::stopRequested();
+                for (pivot = i; pivot < n && !m[pivot].test(i); pivot++)
+                { // searching for the row with Xi component equal true
+                }
+                if (pivot != n && pivot != i)
+                    m.swapRows(i, pivot);
+            }
+            sync.arrive_and_wait();
+            if (stop)
+                break;
+
+            // the rows between i and the pivot have no Xi component,
+            // so it's safe to start right below the row i
+            if (pivot != n)
+                for (std::size_t block = i + 1 + worker * blockRows; block < n;
+                     block += workers * blockRows)
+                    for (std::size_t j = block;
+                         j < std::min(block + blockRows, n);
+                         j++)
+                        if (m[j].test(i))
+                        {
+                            m[j] ^= m[i];
+                            xors++;
+                        }
+
+            // the pivot is overwritten by the next iteration
+            sync.arrive_and_wait();
+        }
+        if (counted)
+            instrumentation::countRowXors(xors, m.rowStride());
+    });
+    if (stop)
+        cancellation::checkpoint();
+}
+} // namespace elimination
+} // namespace SecureBoxHack
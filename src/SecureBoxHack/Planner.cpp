@@ -0,0 +1,296 @@
+#include "Planner.h"
+#include "BitKernels.h"
+#include "BoxState.h"
+#include "Cancellation.h"
+#include "Instrumentation.h"
+#include "ThreadPool.h"
+#include "helpers.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+using namespace SecureBoxHack;
+
+namespace
+{
+// every host times the same state of the shape
+constexpr uint64_t seed = 20250107;
+
+const char *const wisdomHeader =
+    "# secret_box wisdom: host height width engine seconds";
+
+std::optional<EliminationEngine> parseEngine(const std::string &name)
+{
+    for (const auto engine : {EliminationEngine::Naive,
+                              EliminationEngine::FourRussians,
+                              EliminationEngine::Parallel,
+                              EliminationEngine::OutOfCore})
+        if (name == Planner::engineName(engine))
+            return engine;
+    return std::nullopt;
+}
+
+#if defined(__linux__) && defined(_SC_LEVEL2_CACHE_SIZE) &&                  \
+    defined(_SC_LEVEL3_CACHE_SIZE)
+/// @brief Returns the cache size in kilobytes, 0 if it's unknown
+long cacheKilobytes(int level)
+{
+    const long bytes = sysconf(level);
+    return bytes > 0 ? bytes / 1024 : 0;
+}
+#endif
+
+/// @brief Returns the part of the host key which doesn't change
+/// while the process runs, the instruction set and the cache sizes
+std::string hardwareKey()
+{
+    std::string key = kernels::active().name;
+#if defined(__linux__) && defined(_SC_LEVEL2_CACHE_SIZE) &&                  \
+    defined(_SC_LEVEL3_CACHE_SIZE)
+    for (const auto &[name, level] : {std::pair{"/l2:", _SC_LEVEL2_CACHE_SIZE},
+                                      std::pair{"/l3:", _SC_LEVEL3_CACHE_SIZE}})
+        key += name + std::to_string(cacheKilobytes(level)) + "k";
+#endif
+    return key;
+}
+} // namespace
+
+Planner::Planner(Mode planMode) : mutex(), mode(planMode), plans(), wisdomFile()
+{
+}
+
+EliminationEngine Planner::engineFor(uint32_t y, uint32_t x)
+{
+    Key key{hostKey(), y, x};
+    {
+        std::lock_guard lock(mutex);
+        if (auto it = plans.find(key); it != plans.end())
+            return it->second.engine;
+        if (mode == Mode::Estimate)
+            return EliminationEngine::FourRussians;
+    }
+
+    const Plan plan = time(y, x);
+    record(key, plan);
+    return plan.engine;
+}
+
+Planner::Plan Planner::measure(uint32_t y, uint32_t x)
+{
+    const Plan plan = time(y, x);
+    record({hostKey(), y, x}, plan);
+    return plan;
+}
+
+std::optional<Planner::Plan> Planner::find(uint32_t y, uint32_t x) const
+{
+    const Key key{hostKey(), y, x};
+    std::lock_guard lock(mutex);
+    if (auto it = plans.find(key); it != plans.end())
+        return it->second;
+    return std::nullopt;
+}
+
+void Planner::setMode(Mode planMode)
+{
+    std::lock_guard lock(mutex);
+    mode = planMode;
+}
+
+void Planner::setWisdomFile(std::filesystem::path path)
+{
+    if (!path.empty() && std::filesystem::exists(path))
+        load(path);
+    std::lock_guard lock(mutex);
+    wisdomFile = std::move(path);
+}
+
+void Planner::load(const std::filesystem::path &path)
+{
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error("Can't read " + path.string());
+
+    std::map<Key, Plan> loaded;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string host, name;
+        uint32_t y = 0, x = 0;
+        double seconds = 0;
+        if (!(fields >> host >> y >> x >> name >> seconds) || !y || !x)
+            continue;
+        if (const auto engine = parseEngine(name))
+            loaded[{host, y, x}] = Plan{*engine, seconds};
+    }
+
+    std::lock_guard lock(mutex);
+    for (auto &[key, plan] : loaded)
+        plans[key] = plan;
+}
+
+void Planner::save(const std::filesystem::path &path) const
+{
+    std::lock_guard lock(mutex);
+    write(path);
+}
+
+std::size_t Planner::size() const
+{
+    std::lock_guard lock(mutex);
+    return plans.size();
+}
+
+void Planner::clear()
+{
+    std::lock_guard lock(mutex);
+    plans.clear();
+}
+
+const std::string &Planner::hostKey()
+{
+    static const std::string hardware = hardwareKey();
+    // the shared pool may be reconfigured, so the key is rebuilt only
+    // when its threads change
+    thread_local std::size_t threads = 0;
+    thread_local std::string key;
+    if (const std::size_t poolThreads = ThreadPool::shared().size();
+        poolThreads != threads)
+    {
+        threads = poolThreads;
+        key = hardware + "/t" + std::to_string(threads);
+    }
+    return key;
+}
+
+const char *Planner::engineName(EliminationEngine engine)
+{
+    switch (engine)
+    {
+    case EliminationEngine::Naive:
+        return "naive";
+    case EliminationEngine::FourRussians:
+        return "four_russians";
+    case EliminationEngine::Parallel:
+        return "parallel";
+    case EliminationEngine::OutOfCore:
+        return "out_of_core";
+    case EliminationEngine::Auto:
+        break;
+    }
+    return "auto";
+}
+
+std::vector<EliminationEngine> Planner::candidates()
+{
+    std::vector<EliminationEngine> engines{EliminationEngine::FourRussians};
+    if (ThreadPool::shared().size() > 1)
+        engines.push_back(EliminationEngine::Parallel);
+    engines.push_back(EliminationEngine::Naive);
+    return engines;
+}
+
+Planner &Planner::shared()
+{
+    static Planner planner;
+    return planner;
+}
+
+Planner::Plan Planner::time(uint32_t y, uint32_t x)
+{
+    // the toggles of the unlocked box, so the whole solve is timed
+    std::mt19937_64 rng(seed ^ (uint64_t{y} << 32) ^ x);
+    BoxState box(y, x);
+    for (std::size_t i = 0; i < std::size_t{y} * x / 2; i++)
+        box.toggle(static_cast<uint32_t>(rng() % y),
+                   static_cast<uint32_t>(rng() % x));
+    const auto packed = helpers::packState(box.getState());
+
+    // the trials aren't the solves of the caller, so they are left out
+    // of the counters and the latency histograms
+    const instrumentation::Suppression quiet;
+
+    // the trials keep the token and the deadline of the caller
+    const cancellation::StopCondition *caller = cancellation::installed();
+    const cancellation::StopCondition callerCondition =
+        caller ? *caller : cancellation::StopCondition{};
+
+    using Seconds = std::chrono::duration<double>;
+    std::optional<Plan> best;
+    for (const auto engine : candidates())
+    {
+        for (int i = 0; i < repeats; i++)
+        {
+            // the engine slower than the best one is stopped at its time
+            cancellation::StopCondition condition = callerCondition;
+            const auto start = cancellation::Clock::now();
+            if (best)
+                condition.deadline = std::min(
+                    condition.deadline,
+                    start +
+                        std::chrono::duration_cast<
+                            cancellation::Clock::duration>(
+                            Seconds(best->seconds)));
+            try
+            {
+                cancellation::Scope scope(condition);
+                BoxHack(packed, y, x, engine).getUnlockSequence();
+            }
+            catch (const SolveStopped &)
+            {
+                // the caller's stop ends the planning without the plan
+                if (callerCondition.check())
+                    throw;
+                break;
+            }
+
+            const double seconds =
+                Seconds(cancellation::Clock::now() - start).count();
+            if (!best || seconds < best->seconds)
+                best = Plan{engine, seconds};
+        }
+    }
+
+    helpers::logFormat(helpers::LogLevel::INFO,
+                       "Planned %s elimination for %ux%u, %.6f s",
+                       engineName(best->engine),
+                       y,
+                       x,
+                       best->seconds);
+    return *best;
+}
+
+void Planner::record(const Key &key, const Plan &plan)
+{
+    std::lock_guard lock(mutex);
+    plans[key] = plan;
+    if (!wisdomFile.empty())
+        write(wisdomFile);
+}
+
+void Planner::write(const std::filesystem::path &path) const
+{
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        file << wisdomHeader << '\n';
+        for (const auto &[key, plan] : plans)
+            file << std::get<0>(key) << ' ' << std::get<1>(key) << ' '
+                 << std::get<2>(key) << ' ' << engineName(plan.engine) << ' '
+                 << plan.seconds << '\n';
+        if (!file.flush())
+            throw std::runtime_error("Can't write " + temporary.string());
+    }
+    std::filesystem::rename(temporary, path);
+}
@@ -0,0 +1,114 @@
+#include "ReusableHack.h"
+#include "FixedShapeHack.h"
+#include "Instrumentation.h"
+#include "helpers.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace SecureBoxHack;
+
+ReusableHack::ReusableHack(FactorizationCache &cache) : factorizations(cache)
+{
+}
+
+ReusableHack::Workspace &ReusableHack::workspace()
+{
+    thread_local Workspace space;
+    return space;
+}
+
+ReusableHack::Workspace &ReusableHack::reserve(std::size_t bits)
+{
+    Workspace &space = workspace();
+    if (space.rows.columns() < bits)
+        // the capacity is doubled, so the growing shapes reallocate
+        // a logarithmic number of times
+        space.rows = BitMatrix(2, std::max(bits, space.rows.columns() * 2));
+    return space;
+}
+
+bool ReusableHack::solve(std::span<const uint64_t> packedState,
+                         uint32_t height,
+                         uint32_t width,
+                         ToggleSequence &toggles) const
+{
+    const std::size_t n = std::size_t{height} * width;
+    const std::size_t words = (n + 63) / 64;
+    if (packedState.size() < words)
+        throw std::invalid_argument("ReusableHack packed state is too short");
+
+    Workspace &space = reserve(n);
+    const BitRow state(space.rows.rowData(0), n, BitMatrix::strideFor(n));
+    state.reset();
+    std::copy(packedState.begin(),
+              packedState.begin() + static_cast<std::ptrdiff_t>(words),
+              state.data());
+    // the bits past the cells take part in the parities of the rows
+    if (n % 64)
+        state.data()[words - 1] &= (uint64_t{1} << (n % 64)) - 1;
+    return solvePacked(space, height, width, toggles);
+}
+
+bool ReusableHack::solve(const BoolMatrix &state, ToggleSequence &toggles) const
+{
+    const auto height = static_cast<uint32_t>(state.size());
+    const auto width = static_cast<uint32_t>(helpers::stateWidth(state));
+    const std::size_t n = std::size_t{height} * width;
+
+    Workspace &space = reserve(n);
+    const BitRow packed(space.rows.rowData(0), n, BitMatrix::strideFor(n));
+    packed.reset();
+    for (std::size_t i = 0; i < height; i++)
+        for (std::size_t j = 0; j < width; j++)
+            if (state[i][j])
+                packed.set(i * width + j);
+    return solvePacked(space, height, width, toggles);
+}
+
+bool ReusableHack::solvePacked(Workspace &space,
+                               uint32_t height,
+                               uint32_t width,
+                               ToggleSequence &toggles) const
+{
+    instrumentation::count(instrumentation::Counter::Solves);
+    toggles.clear();
+
+    const std::size_t n = std::size_t{height} * width;
+    const std::size_t stride = BitMatrix::strideFor(n);
+    const ConstBitRow state(space.rows.rowData(0), n, stride);
+    const BitRow solution(space.rows.rowData(1), n, stride);
+    solution.reset();
+
+    bool solvable = false;
+    if (const auto solver = fixed::findSolver(height, width))
+        solvable = solver({state.data(), stride}, {solution.data(), stride});
+    else
+    {
+        auto factorization = space.factorization.lock();
+        if (!factorization || factorization->height() != height ||
+            factorization->width() != width)
+        {
+            factorization = factorizations.get(height, width);
+            space.factorization = factorization;
+        }
+        solvable = factorization->solve(state, solution);
+    }
+
+    if (!solvable)
+    {
+        // the level is checked before the message is built, so the filtered
+        // out message doesn't allocate the string
+        helpers::logFormat(helpers::LogLevel::INFO,
+                           "The state can't be unlocked");
+        return false;
+    }
+
+    for (std::size_t i = solution.findFirst(); i < n;
+         i = solution.findFirst(i + 1))
+        toggles.push_back(helpers::toCartesianCoordinates(i, width));
+
+    helpers::logFormat(helpers::LogLevel::INFO,
+                       "Solution found. Requires %zu toggles",
+                       toggles.size());
+    return true;
+}
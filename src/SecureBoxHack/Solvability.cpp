@@ -0,0 +1,82 @@
+#include "Solvability.h"
+#include "helpers.h"
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+namespace SecureBoxHack
+{
+namespace solvability
+{
+namespace
+{
+/// @brief Returns the bits [pos, pos + count) of the bitmap, count <= 64
+uint64_t extractBits(std::span<const uint64_t> words,
+                     std::size_t pos,
+                     std::size_t count)
+{
+    const std::size_t w = pos / 64, shift = pos % 64;
+    uint64_t bits = words[w] >> shift;
+    if (shift && shift + count > 64)
+        bits |= words[w + 1] << (64 - shift);
+    return count == 64 ? bits : bits & ((uint64_t{1} << count) - 1);
+}
+} // namespace
+
+bool isSolvable(std::span<const uint64_t> packedState,
+                uint32_t height,
+                uint32_t width)
+{
+    const bool xOdd = width % 2, yOdd = height % 2;
+    if (!xOdd && !yOdd)
+        return true;
+
+    // the XOR of all the rows holds the column parities
+    const std::size_t rowWords = (std::size_t{width} + 63) / 64;
+    std::vector<uint64_t> columns(yOdd ? rowWords : 0);
+
+    bool firstRow = false;
+    for (std::size_t i = 0; i < height; i++)
+    {
+        uint64_t parity = 0;
+        for (std::size_t k = 0; k < rowWords; k++)
+        {
+            const std::size_t count =
+                std::min<std::size_t>(64, std::size_t{width} - k * 64);
+            const uint64_t bits =
+                extractBits(packedState, i * width + k * 64, count);
+            parity ^= bits;
+            if (yOdd)
+                columns[k] ^= bits;
+        }
+        const bool rowParity = std::popcount(parity) & 1;
+        if (i == 0)
+            firstRow = rowParity;
+        else if (xOdd && rowParity != firstRow)
+            return false;
+    }
+    if (!yOdd)
+        return true;
+
+    // the column parities have to be all 0 or all 1
+    const uint64_t fill = columns[0] & 1 ? ~uint64_t{0} : 0;
+    for (std::size_t k = 0; k < rowWords; k++)
+    {
+        const std::size_t count =
+            std::min<std::size_t>(64, std::size_t{width} - k * 64);
+        const uint64_t mask =
+            count == 64 ? ~uint64_t{0} : (uint64_t{1} << count) - 1;
+        if ((columns[k] ^ fill) & mask)
+            return false;
+    }
+    return true;
+}
+
+bool isSolvable(const BoolMatrix &state)
+{
+    return isSolvable(helpers::packState(state),
+                      static_cast<uint32_t>(state.size()),
+                      static_cast<uint32_t>(helpers::stateWidth(state)));
+}
+} // namespace solvability
+} // namespace SecureBoxHack
@@ -0,0 +1,259 @@
+#include "StreamSolver.h"
+#include "FixedShapeHack.h"
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace SecureBoxHack
+{
+namespace stream
+{
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+/// @brief The box in flight
+struct Slot
+{
+    BoxInput box{};
+    ToggleSequence toggles{};
+    bool solvable = false;
+    bool done = false;
+    Clock::time_point readAt{};
+};
+
+std::chrono::duration<double> percentile(std::vector<Clock::duration> &sorted,
+                                         double fraction)
+{
+    if (sorted.empty())
+        return {};
+    const auto last = static_cast<double>(sorted.size() - 1);
+    return sorted[static_cast<std::size_t>(fraction * last + 0.5)];
+}
+} // namespace
+
+std::optional<BoxInput> parseBox(const std::string &line)
+{
+    std::istringstream is(line);
+    std::string token;
+    if (!(is >> token) || token[0] == '#')
+        return std::nullopt;
+
+    BoxInput box{};
+    is.clear();
+    is.str(line);
+    if (!(is >> box.height >> box.width) || !box.height || !box.width)
+        throw std::invalid_argument("Bad box shape: " + line);
+
+    const std::size_t words =
+        (std::size_t{box.height} * box.width + 63) / 64;
+    box.packed.reserve(words);
+    while (is >> token)
+    {
+        char *end = nullptr;
+        box.packed.push_back(std::strtoull(token.c_str(), &end, 16));
+        if (*end || token.size() > 16 ||
+            !std::isxdigit(static_cast<unsigned char>(token[0])))
+            throw std::invalid_argument("Bad box word: " + token);
+    }
+    if (box.packed.size() != words)
+        throw std::invalid_argument("Bad box word count: " + line);
+
+    // the bits past the cells are expected to be zero
+    if (const std::size_t tail = std::size_t{box.height} * box.width % 64;
+        tail && box.packed.back() >> tail)
+        throw std::invalid_argument("Bad box padding: " + line);
+    return box;
+}
+
+std::string formatResult(std::size_t index,
+                         bool solvable,
+                         const ToggleSequence &toggles)
+{
+    std::string out = std::to_string(index);
+    if (!solvable)
+        return out + " locked";
+
+    out += ' ';
+    out += std::to_string(toggles.size());
+    for (auto [posY, posX] : toggles)
+    {
+        out += ' ';
+        out += std::to_string(posY);
+        out += ',';
+        out += std::to_string(posX);
+    }
+    return out;
+}
+
+std::string formatBox(const BoxInput &box)
+{
+    std::ostringstream os;
+    os << box.height << ' ' << box.width << std::hex;
+    for (const uint64_t word : box.packed)
+        os << ' ' << word;
+    return os.str();
+}
+
+StreamSolver::StreamSolver(std::size_t threads,
+                           std::size_t inFlight,
+                           EliminationEngine elimination)
+    : workers(threads ? threads
+                      : std::max(1u, std::thread::hardware_concurrency())),
+      window(std::max<std::size_t>(1, inFlight)), engine(elimination)
+{
+}
+
+StreamStats StreamSolver::run(const Reader &read, const Writer &write) const
+{
+    std::vector<Slot> slots(window);
+    std::mutex mutex;
+    std::condition_variable slotFree, jobReady, resultReady;
+    // the filled slots waiting for a worker
+    std::deque<std::size_t> jobs;
+    // the boxes read and written so far
+    std::size_t readCount = 0, written = 0;
+    bool eof = false, stop = false;
+    std::exception_ptr error;
+    const auto start = Clock::now();
+
+    const auto fail = [&](std::exception_ptr e) {
+        std::lock_guard lock(mutex);
+        if (!error)
+            error = e;
+        stop = true;
+        slotFree.notify_all();
+        jobReady.notify_all();
+        resultReady.notify_all();
+    };
+
+    std::thread reader([&] {
+        try
+        {
+            for (;;)
+            {
+                std::unique_lock lock(mutex);
+                slotFree.wait(lock, [&] {
+                    return stop || readCount - written < window;
+                });
+                if (stop)
+                    return;
+                // the slot isn't referenced by the others until it's queued
+                Slot &slot = slots[readCount % window];
+                lock.unlock();
+
+                auto box = read();
+                const auto readAt = Clock::now();
+
+                lock.lock();
+                if (!box)
+                {
+                    eof = true;
+                    jobReady.notify_all();
+                    resultReady.notify_all();
+                    return;
+                }
+                slot.box = std::move(*box);
+                slot.readAt = readAt;
+                jobs.push_back(readCount++);
+                jobReady.notify_one();
+            }
+        }
+        catch (...)
+        {
+            fail(std::current_exception());
+        }
+    });
+
+    std::vector<std::thread> solvers;
+    for (std::size_t w = 0; w < workers; w++)
+        solvers.emplace_back([&] {
+            try
+            {
+                for (;;)
+                {
+                    std::unique_lock lock(mutex);
+                    jobReady.wait(lock, [&] {
+                        return stop || eof || !jobs.empty();
+                    });
+                    if (stop || jobs.empty())
+                        return;
+                    const std::size_t index = jobs.front();
+                    jobs.pop_front();
+                    Slot &slot = slots[index % window];
+                    lock.unlock();
+
+                    FixedShapeHack hack(slot.box.packed,
+                                        slot.box.height,
+                                        slot.box.width,
+                                        engine);
+                    slot.toggles = hack.getUnlockSequence();
+                    slot.solvable = hack.isSolvable();
+
+                    lock.lock();
+                    slot.done = true;
+                    if (index == written)
+                        resultReady.notify_one();
+                }
+            }
+            catch (...)
+            {
+                fail(std::current_exception());
+            }
+        });
+
+    StreamStats stats;
+    std::vector<Clock::duration> latencies;
+    try
+    {
+        for (;;)
+        {
+            std::unique_lock lock(mutex);
+            resultReady.wait(lock, [&] {
+                return stop || (eof && written == readCount) ||
+                       (written < readCount && slots[written % window].done);
+            });
+            if (stop || written == readCount)
+                break;
+            Slot &slot = slots[written % window];
+            lock.unlock();
+
+            write(written, slot.solvable, slot.toggles);
+            latencies.push_back(Clock::now() - slot.readAt);
+            stats.unsolvable += !slot.solvable;
+
+            lock.lock();
+            slot.done = false;
+            written++;
+            slotFree.notify_one();
+        }
+    }
+    catch (...)
+    {
+        fail(std::current_exception());
+    }
+
+    reader.join();
+    for (auto &solver : solvers)
+        solver.join();
+    if (error)
+        std::rethrow_exception(error);
+
+    stats.boxes = written;
+    stats.elapsed = Clock::now() - start;
+    std::ranges::sort(latencies);
+    stats.p50 = percentile(latencies, 0.5);
+    stats.p90 = percentile(latencies, 0.9);
+    stats.p99 = percentile(latencies, 0.99);
+    stats.max = percentile(latencies, 1.0);
+    return stats;
+}
+} // namespace stream
+} // namespace SecureBoxHack
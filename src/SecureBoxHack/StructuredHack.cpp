@@ -0,0 +1,96 @@
+#include "StructuredHack.h"
+#include "helpers.h"
+
+using namespace SecureBoxHack;
+
+StructuredHack::StructuredHack(const BoolMatrix &initialState)
+    : state(initialState), y(initialState.size()),
+      x(initialState[0].size()), rowParity(y), colParity(x), rowToggles(y),
+      colToggles(x), totalToggles(false), solvable(false)
+{
+    computeParities();
+    solveParities();
+}
+
+bool StructuredHack::isSolvable() const
+{
+    return solvable;
+}
+
+ToggleSequence StructuredHack::getUnlockSequence()
+{
+    ToggleSequence togglCells;
+    if (!solvable)
+    {
+        helpers::logMessage("The state can't be unlocked");
+        return togglCells;
+    }
+
+    for (std::size_t i = 0; i < y; i++)
+        for (std::size_t j = 0; j < x; j++)
+            if (state[i][j] ^ rowToggles.test(i) ^ colToggles.test(j))
+                togglCells.emplace_back(static_cast<uint32_t>(i),
+                                        static_cast<uint32_t>(j));
+
+    helpers::logFormat(helpers::LogLevel::INFO,
+                       "Solution found. Requires %zu toggles",
+                       togglCells.size());
+
+    return togglCells;
+}
+
+void StructuredHack::computeParities()
+{
+    for (std::size_t i = 0; i < y; i++)
+    {
+        bool parity = false;
+        for (std::size_t j = 0; j < x; j++)
+        {
+            if (!state[i][j])
+                continue;
+            parity = !parity;
+            colParity.set(j, !colParity.test(j));
+        }
+        rowParity.set(i, parity);
+    }
+}
+
+void StructuredHack::solveParities()
+{
+    const bool xOdd = x % 2, yOdd = y % 2;
+
+    // (x + 1) is even, so every row parity equals to T
+    if (xOdd)
+        for (std::size_t i = 1; i < y; i++)
+            if (rowParity.test(i) != rowParity.test(0))
+                return;
+    // (y + 1) is even, so every column parity equals to T
+    if (yOdd)
+        for (std::size_t j = 1; j < x; j++)
+            if (colParity.test(j) != colParity.test(0))
+                return;
+    solvable = true;
+
+    if (xOdd)
+        totalToggles = rowParity.test(0);
+    else if (yOdd)
+        totalToggles = colParity.test(0);
+    else
+        // both dimensions are even: T equals to the parity of the whole state
+        for (std::size_t i = 0; i < y; i++)
+            totalToggles = totalToggles ^ rowParity.test(i);
+
+    // The odd dimension leaves the line toggles free as long as their
+    // parity is T. Put all of them into the first line
+    if (xOdd)
+        rowToggles.set(0, totalToggles);
+    else
+        for (std::size_t i = 0; i < y; i++)
+            rowToggles.set(i, rowParity.test(i) ^ totalToggles);
+
+    if (yOdd)
+        colToggles.set(0, totalToggles);
+    else
+        for (std::size_t j = 0; j < x; j++)
+            colToggles.set(j, colParity.test(j) ^ totalToggles);
+}
@@ -0,0 +1,91 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+using namespace SecureBoxHack;
+
+ThreadPool::ThreadPool(std::size_t threads)
+    : workers(), runMutex(), mutex(), wakeUp(), done(), task(nullptr),
+      generation(0), pending(0), stopping(false)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    workers.reserve(threads - 1);
+    for (std::size_t i = 1; i < threads; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+std::size_t ThreadPool::size() const
+{
+    return workers.size() + 1;
+}
+
+void ThreadPool::run(const Task &newTask)
+{
+    std::lock_guard runLock(runMutex);
+    {
+        std::lock_guard lock(mutex);
+        task = &newTask;
+        pending = workers.size();
+        generation++;
+    }
+    wakeUp.notify_all();
+
+    newTask(0, size());
+
+    std::unique_lock lock(mutex);
+    done.wait(lock, [this] { return pending == 0; });
+    task = nullptr;
+}
+
+void ThreadPool::workerLoop(std::size_t index)
+{
+    std::size_t seen = 0;
+    for (;;)
+    {
+        const Task *current = nullptr;
+        {
+            std::unique_lock lock(mutex);
+            wakeUp.wait(lock,
+                        [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+            current = task;
+        }
+
+        (*current)(index, size());
+
+        std::lock_guard lock(mutex);
+        if (--pending == 0)
+            done.notify_one();
+    }
+}
+
+std::unique_ptr<ThreadPool> &ThreadPool::sharedPool()
+{
+    static std::unique_ptr<ThreadPool> pool = std::make_unique<ThreadPool>();
+    return pool;
+}
+
+ThreadPool &ThreadPool::shared()
+{
+    return *sharedPool();
+}
+
+void ThreadPool::configureShared(std::size_t threads)
+{
+    if (sharedPool()->size() != threads || threads == 0)
+        sharedPool() = std::make_unique<ThreadPool>(threads);
+}
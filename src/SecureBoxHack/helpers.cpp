@@ -1,5 +1,7 @@
 #include "helpers.h"
 #include <chrono>
+#include <cstdarg>
+#include <cstdio>
 
 namespace SecureBoxHack
 {
@@ -27,10 +29,63 @@ void logMessage(std::string message, LogLevel level)
     std::cout << "\t" << message << "\n";
 }
 
+void logFormat(LogLevel level, const char *format, ...)
+{
+    if (logLevel < level)
+        return;
+
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    logMessage(buffer, level);
+}
+
 std::tuple<uint32_t, uint32_t> toCartesianCoordinates(std::size_t i,
                                                       std::size_t x)
 {
     return {static_cast<uint32_t>(i / x), static_cast<uint32_t>(i % x)};
 }
+
+std::size_t stateWidth(const BoolMatrix &state)
+{
+    return state.empty() ? 0 : state[0].size();
+}
+
+std::vector<uint64_t> packState(const BoolMatrix &state)
+{
+    constexpr std::size_t wordBits = 64;
+    std::vector<uint64_t> packed(
+        (state.size() * stateWidth(state) + wordBits - 1) / wordBits, 0);
+
+    std::size_t pos = 0;
+    uint64_t word = 0;
+    for (const auto &row : state)
+        for (const bool cell : row)
+        {
+            word |= static_cast<uint64_t>(cell) << (pos % wordBits);
+            if (++pos % wordBits == 0)
+            {
+                packed[pos / wordBits - 1] = word;
+                word = 0;
+            }
+        }
+    if (pos % wordBits)
+        packed[pos / wordBits] = word;
+    return packed;
+}
+
+void fillToggleRow(BitRow row, std::size_t i, std::size_t y, std::size_t x)
+{
+    // the cell coordinates
+    auto [posY, posX] = toCartesianCoordinates(i, x);
+    // fill the column
+    for (std::size_t j = 0; j < y; j++)
+        row.set(j * x + posX);
+    // fill the row
+    for (std::size_t j = 0; j < x; j++)
+        row.set(posY * x + j);
+}
 } // namespace helpers
 } // namespace SecureBoxHack
@@ -0,0 +1,210 @@
+#ifndef Archive_h
+#define Archive_h
+
+#include "types.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <span>
+
+namespace SecureBoxHack
+{
+/// @brief Binary archive of the box states and their solutions.
+///
+/// The file is
+///     the 32 bytes header: magic, format version, word size,
+///         the number of the records
+///     the records one after another
+/// The record is
+///     the 16 bytes header: the box shape, the kind of the solution
+///         and the number of the solution bytes
+///     the (y * x + 63) / 64 words of the row-major packed state,
+///         see helpers::packState()
+///     the solution bytes padded to the word
+/// The solution is either the packed toggle bitmap of the same layout as
+/// the state, or the flat indices i * x + j of the toggles in the ascending
+/// order as the LEB128 varints of the differences between the successive
+/// indices. Every record starts at the word boundary, so the mapped file
+/// is read in place without copying. The words are stored in the native
+/// byte order
+namespace archive
+{
+// the version of the file format, bumped on every layout change
+inline constexpr uint32_t formatVersion = 1;
+
+/// @brief The kind of the solution stored with the state
+enum class Solution : uint8_t
+{
+    // the state only
+    None,
+    // the state can't be unlocked
+    Locked,
+    // the packed bitmap of the toggles
+    Bitmap,
+    // the delta-encoded flat indices of the toggles
+    Deltas
+};
+
+/// @brief The encoding of the solutions chosen by the writer
+enum class Encoding
+{
+    Bitmap,
+    Deltas,
+    // the smaller of the two, the deltas win for the sparse solutions
+    Smallest
+};
+
+/// @brief The record of the archive. The spans view the mapped file and
+/// are valid while the Reader is alive
+struct Record
+{
+    uint32_t height = 0;
+    uint32_t width = 0;
+    // the row-major packed state
+    std::span<const uint64_t> state{};
+    Solution solution = Solution::None;
+    // the bitmap words or the varints of the solution, without the padding
+    std::span<const uint8_t> solutionBytes{};
+
+    /// @brief Returns false if the state is stored as the locked one
+    bool isSolvable() const
+    {
+        return solution != Solution::Locked;
+    }
+
+    /// @brief Decodes the toggles of the solution in the row-major order.
+    /// Empty if the record has no solution
+    /// @throws std::runtime_error if a toggle is out of the box
+    /// or the varint is truncated
+    ToggleSequence toggles() const;
+};
+
+/// @brief Streaming writer of the archive. The records are appended
+/// through the buffered stream into the file next to the destination,
+/// which is renamed by close(), so the readers never see the archive
+/// partially written. The archive isn't published if close() isn't called
+class Writer
+{
+public:
+    /// @brief Writer constructor
+    /// @param path The path of the archive
+    /// @param encoding The encoding of the solutions
+    explicit Writer(const std::filesystem::path &path,
+                    Encoding encoding = Encoding::Smallest);
+    ~Writer();
+
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    /// @brief Appends the state without the solution
+    /// @param height The number of the rows of the box
+    /// @param width The number of the columns of the box
+    /// @param packedState The row-major packed state, the bits past
+    /// the cells are expected to be zero
+    void add(uint32_t height,
+             uint32_t width,
+             std::span<const uint64_t> packedState);
+
+    /// @brief Appends the state and its solution. The repeated toggles
+    /// of the same cell cancel each other
+    /// @param solvable false stores the state as the locked one
+    /// and ignores the toggles
+    void add(uint32_t height,
+             uint32_t width,
+             std::span<const uint64_t> packedState,
+             bool solvable,
+             const ToggleSequence &toggles);
+
+    /// @brief Writes the number of the records and publishes the archive.
+    /// Throws std::runtime_error if the file can't be written
+    void close();
+
+    /// @brief Returns the number of the records added
+    std::size_t size() const;
+
+private:
+    void append(uint32_t height,
+                uint32_t width,
+                std::span<const uint64_t> packedState,
+                Solution solution,
+                std::span<const uint8_t> solutionBytes);
+
+    const std::filesystem::path destination;
+    const std::filesystem::path temporary;
+    const Encoding encoding;
+    std::ofstream file;
+    std::size_t records = 0;
+    bool closed = false;
+};
+
+/// @brief Reader of the archive mapping the file into memory.
+/// The iteration parses the record headers in place, the states and
+/// the solutions aren't copied
+class Reader
+{
+public:
+    /// @brief Forward iterator over the records.
+    /// Throws std::runtime_error reaching the truncated or corrupted record
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Record;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Record *;
+        using reference = const Record &;
+
+        Iterator() = default;
+        Iterator(const uint8_t *position, const uint8_t *end);
+
+        reference operator*() const
+        {
+            return record;
+        }
+        pointer operator->() const
+        {
+            return &record;
+        }
+        Iterator &operator++();
+        Iterator operator++(int);
+        bool operator==(const Iterator &other) const
+        {
+            return current == other.current;
+        }
+
+    private:
+        void parse();
+
+        const uint8_t *current = nullptr;
+        const uint8_t *next = nullptr;
+        const uint8_t *last = nullptr;
+        Record record{};
+    };
+
+    /// @brief Reader constructor.
+    /// Throws std::runtime_error if the file isn't the archive
+    /// @param path The path of the archive
+    explicit Reader(const std::filesystem::path &path);
+
+    // the copies share the mapping
+    Reader(const Reader &) = default;
+    Reader &operator=(const Reader &) = default;
+
+    /// @brief Returns the number of the records
+    std::size_t size() const;
+
+    Iterator begin() const;
+    Iterator end() const;
+
+private:
+    std::shared_ptr<const void> storage;
+    const uint8_t *first = nullptr;
+    const uint8_t *last = nullptr;
+    std::size_t records = 0;
+};
+} // namespace archive
+} // namespace SecureBoxHack
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef AsyncSolver_h
+#define AsyncSolver_h
+
+#include "BoxHack.h"
+#include "Cancellation.h"
+#include "types.h"
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SecureBoxHack
+{
+/// @brief The priority of the queued solve. The queued solves are started
+/// in the priority order and in the submission order within the priority
+enum class Priority
+{
+    Low,
+    Normal,
+    High
+};
+
+/// @brief The options of the asynchronous solve
+struct SolveOptions
+{
+    // the elimination of the boxes too large for the compile-time solvers
+    EliminationEngine engine = EliminationEngine::FourRussians;
+    bool minimizeToggles = false;
+    Priority priority = Priority::Normal;
+    // the running solve fails with SolveStopped once the deadline is
+    // passed. The queued one isn't swept, it fails without being started
+    // when a thread takes it past the deadline
+    cancellation::Clock::time_point deadline =
+        cancellation::Clock::time_point::max();
+    // the solve fails with SolveStopped once the token is cancelled
+    CancellationToken token{};
+};
+
+/// @brief The outcome of the asynchronous solve
+struct SolveResult
+{
+    bool solvable = false;
+    // empty if the state can't be unlocked
+    ToggleSequence toggles{};
+};
+
+/// @brief Executor solving the boxes on its own threads.
+///
+/// The solves are queued by the priority, so the high priority small boxes
+/// are started before the large ones queued earlier, and every thread takes
+/// the next solve as soon as it's done, so a large box only occupies one of
+/// them. The boxes are solved by FixedShapeHack, i.e. the small shapes take
+/// microseconds, and by BoxHack for the minimized toggles. The stop
+/// condition of the solve is installed for the elimination, which checks
+/// it between the blocks of the pivots and fails the solve with
+/// SolveStopped. The Parallel engine shares ThreadPool::shared(), so
+/// its solves are serialized
+class AsyncSolver
+{
+public:
+    /// @brief Awaitable of the solve for the C++20 coroutines.
+    /// The solve is queued when the coroutine is suspended and the coroutine
+    /// is resumed on the thread of the executor which has solved it
+    class Awaitable
+    {
+    public:
+        Awaitable(AsyncSolver &executor,
+                  std::vector<uint64_t> packedState,
+                  uint32_t height,
+                  uint32_t width,
+                  SolveOptions options);
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle);
+
+        /// @brief Returns the result or rethrows the error of the solve,
+        /// e.g. SolveStopped
+        SolveResult await_resume();
+
+    private:
+        AsyncSolver &solver;
+        std::vector<uint64_t> packed;
+        uint32_t y, x;
+        SolveOptions solveOptions;
+        SolveResult result;
+        std::exception_ptr error;
+    };
+
+    /// @brief AsyncSolver constructor
+    /// @param threads The number of the solver threads, zero for
+    /// the hardware concurrency
+    explicit AsyncSolver(std::size_t threads = 0);
+
+    /// @brief Waits for the running solves, the queued ones fail
+    /// with SolveStopped
+    ~AsyncSolver();
+
+    AsyncSolver(const AsyncSolver &) = delete;
+    AsyncSolver &operator=(const AsyncSolver &) = delete;
+
+    /// @brief Queues the solve of the packed state
+    /// @param packedState The row-major bitmap of the state, see
+    /// helpers::packState()
+    /// @param height The number of the rows of the box
+    /// @param width The number of the columns of the box
+    /// @param options The engine, the priority and the stop condition
+    /// @return the future of the result. It throws SolveStopped if the solve
+    /// is cancelled or misses the deadline, the queued solve is failed when
+    /// a thread takes it
+    std::future<SolveResult> solveAsync(std::vector<uint64_t> packedState,
+                                        uint32_t height,
+                                        uint32_t width,
+                                        SolveOptions options = {});
+
+    /// @brief Queues the solve of the state
+    /// @param state The state of the box, e.g. SecureBox::getState()
+    /// @param options The engine, the priority and the stop condition
+    std::future<SolveResult> solveAsync(const BoolMatrix &state,
+                                        SolveOptions options = {});
+
+    /// @brief Returns the awaitable of the solve of the packed state,
+    /// e.g. co_await solver.solve(packed, y, x)
+    Awaitable solve(std::vector<uint64_t> packedState,
+                    uint32_t height,
+                    uint32_t width,
+                    SolveOptions options = {});
+
+    /// @brief Returns the number of the solver threads
+    std::size_t size() const;
+
+    /// @brief Returns the executor shared by the callers
+    static AsyncSolver &shared();
+
+private:
+    /// @brief Receives the result or the error of the solve
+    using Completion = std::function<void(SolveResult, std::exception_ptr)>;
+
+    struct Job
+    {
+        Priority priority;
+        // the submission order within the priority
+        uint64_t sequence;
+        std::vector<uint64_t> packed;
+        uint32_t y, x;
+        SolveOptions options;
+        Completion done;
+
+        /// @brief Orders the queue by the priority, then by the sequence
+        bool operator<(const Job &other) const;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    // the heap of the queued jobs, the next one on the top
+    std::vector<Job> queue;
+    uint64_t submitted;
+    bool stopping;
+
+    /// @brief Queues the solve
+    void submit(std::vector<uint64_t> packedState,
+                uint32_t height,
+                uint32_t width,
+                SolveOptions options,
+                Completion done);
+
+    /// @brief The worker thread loop
+    void workerLoop();
+
+    /// @brief Solves the box under its stop condition
+    static void execute(Job &job);
+};
+} // namespace SecureBoxHack
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef BatchHack_h
+#define BatchHack_h
+
+#include "types.h"
+
+namespace SecureBoxHack
+{
+/// @brief Helper class unlocking many SecureBoxes of the same shape at once.
+///
+/// The Gauss matrix of the boxes only differs by the initial state column,
+/// so the states are bit-sliced into the batch of the right-hand side
+/// columns: the bit (i, N + b) is the cell i of the box b. The toggle matrix
+/// is eliminated once into the reduced row echelon form carrying all the
+/// states along, then the pivot row k holds the toggle of its pivot column
+/// for every box and the rows without the pivot flag the unsolvable boxes.
+/// The state columns are processed in the passes of batchWidth boxes
+class BatchHack
+{
+public:
+    // the number of the states eliminated in a single pass,
+    // i.e. 4 words of the AVX2 register or a half of the AVX-512 line
+    static constexpr std::size_t batchWidth = 256;
+
+    /// @brief BatchHack constructor
+    /// @param initialStates The initial states of the boxes, kept by
+    /// the hack. All the states have to have the same dimensions
+    /// @throws std::invalid_argument if the dimensions differ
+    BatchHack(std::vector<BoolMatrix> initialStates);
+
+    /// @brief Hacks the SecureBoxes and returns the toggles of every box
+    /// @return vector of the toggle sequences in the order of the states.
+    /// The sequence is empty if the state can't be unlocked
+    std::vector<ToggleSequence> getUnlockSequences();
+
+    /// @brief Checks whether the state of the box can be unlocked.
+    /// Valid after getUnlockSequences()
+    /// @param i Zero-based index of the box
+    bool isSolvable(std::size_t i) const;
+
+private:
+    // SeureBox initial lock states
+    const std::vector<BoolMatrix> states;
+    // SecureBox dimentions
+    const std::size_t y, x;
+    // the solvability flag of every box
+    std::vector<bool> solvable;
+
+    /// @brief Solves the boxes [first, first + count) in a single pass
+    /// @param first Zero-based index of the first box of the pass
+    /// @param count The number of the boxes in the pass
+    /// @param sequences The toggle sequences of all the boxes
+    void solvePass(std::size_t first,
+                   std::size_t count,
+                   std::vector<ToggleSequence> &sequences);
+};
+} // namespace SecureBoxHack
+
+#endif
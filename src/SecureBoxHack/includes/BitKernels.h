@@ -0,0 +1,69 @@
+#ifndef BitKernels_h
+#define BitKernels_h
+
+#include <stdint.h>
+#include <vector>
+
+namespace SecureBoxHack
+{
+namespace kernels
+{
+using Word = uint64_t;
+
+/// @brief The set of the word array operations implemented
+/// for a particular instruction set
+struct KernelTable
+{
+    // instruction set name: scalar, sse2, avx2 or avx512
+    const char *name;
+
+    /// @brief dst[i] ^= src[i] for every i < n
+    void (*xorWords)(Word *dst, const Word *src, std::size_t n);
+
+    /// @brief Parity of the dot product of the bit arrays, i.e. the parity
+    /// of popcount(a & b). Computed as popcount of the XOR of all the
+    /// (a[i] & b[i]) words, which has the same parity
+    bool (*andParity)(const Word *a, const Word *b, std::size_t n);
+
+    /// @brief Finds the first set bit with the index not less than from
+    /// @return The bit index or n * 64 if there is no such bit
+    std::size_t (*findFirstSet)(const Word *words,
+                                std::size_t n,
+                                std::size_t from);
+};
+
+/// @brief Returns the fastest kernels supported by the CPU.
+/// The CPU features are checked once on the first call
+const KernelTable &active();
+
+/// @brief Returns all the kernels supported by the CPU, the scalar first
+std::vector<const KernelTable *> available();
+
+inline void xorWords(Word *dst, const Word *src, std::size_t n)
+{
+    active().xorWords(dst, src, n);
+}
+
+inline bool andParity(const Word *a, const Word *b, std::size_t n)
+{
+    return active().andParity(a, b, n);
+}
+
+inline std::size_t findFirstSet(const Word *words,
+                                std::size_t n,
+                                std::size_t from)
+{
+    return active().findFirstSet(words, n, from);
+}
+
+/// @brief Transposes the 64x64 bit block in place, i.e. the bit c of the
+/// word r is swapped with the bit r of the word c. The halves, the quarters
+/// and so on down to the single bits are swapped with the shifts and the
+/// masks, 6 rounds of 32 word pairs, which the compiler vectorizes for any
+/// instruction set, so it isn't in the kernel table
+/// @param block The 64 words of the block
+void transpose64(Word *block);
+} // namespace kernels
+} // namespace SecureBoxHack
+
+#endif
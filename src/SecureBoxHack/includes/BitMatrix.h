@@ -0,0 +1,325 @@
+#ifndef BitMatrix_h
+#define BitMatrix_h
+
+#include "BitKernels.h"
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace SecureBoxHack
+{
+/// @brief View of a bit row stored in the external words.
+/// The view doesn't own the words, so it's cheap to copy and to pass
+/// by value. Copying the view doesn't copy the bits
+/// @tparam W The word type, const-qualified for the read-only view
+template <typename W>
+class BasicBitRow
+{
+public:
+    using Word = kernels::Word;
+    static constexpr std::size_t wordBits = sizeof(Word) * 8;
+
+    /// @brief BasicBitRow constructor
+    /// @param rowWords The words of the row
+    /// @param bits The number of the bits in the row
+    /// @param count The number of the words processed by the row operations.
+    /// The words past the bits are expected to be zero
+    BasicBitRow(W *rowWords, std::size_t bits, std::size_t count)
+        : words(rowWords), bitCount(bits), wordsCount(count)
+    {
+    }
+
+    /// @brief Converts the mutable view into the read-only one
+    operator BasicBitRow<const Word>() const
+    {
+        return {words, bitCount, wordsCount};
+    }
+
+    /// @brief Set the bit value
+    /// @param pos Zero-based bit index
+    /// @param val New value. Default = true
+    void set(std::size_t pos, bool val = true) const
+        requires(!std::is_const_v<W>)
+    {
+        const Word mask = static_cast<Word>(1) << (pos % wordBits);
+        words[pos / wordBits] = (words[pos / wordBits] & ~mask) |
+                                (static_cast<Word>(val) << (pos % wordBits));
+    }
+
+    /// @brief Get the value of the bit in the position
+    /// @param pos Zero-based bit index to be tested
+    /// @return the bit value
+    bool test(std::size_t pos) const
+    {
+        return (words[pos / wordBits] >> (pos % wordBits)) & 1;
+    }
+
+    /// @brief Returns the lastst's bit value
+    /// @return The value of the last bit of the row
+    bool back() const
+    {
+        return test(bitCount - 1);
+    }
+
+    /// @brief Return the number of the bits in the row
+    std::size_t size() const
+    {
+        return bitCount;
+    }
+
+    /// @brief XORs the other row into this one
+    /// @param other The row of the same size
+    /// @return the view of this row
+    const BasicBitRow &operator^=(BasicBitRow<const Word> other) const
+        requires(!std::is_const_v<W>)
+    {
+        kernels::xorWords(words, other.data(), wordsCount);
+        return *this;
+    }
+
+    /// @brief Copies the bits of the other row into this one
+    /// @param other The row of the same size
+    void assign(BasicBitRow<const Word> other) const
+        requires(!std::is_const_v<W>)
+    {
+        std::copy(other.data(), other.data() + wordsCount, words);
+    }
+
+    /// @brief Clears all the bits of the row
+    void reset() const
+        requires(!std::is_const_v<W>)
+    {
+        std::fill(words, words + wordsCount, Word{0});
+    }
+
+    /// @brief Returns the parity of the bits set in both rows,
+    /// i.e. the dot product of the rows over GF(2)
+    /// @param other The row of the same size
+    bool andParity(BasicBitRow<const Word> other) const
+    {
+        return kernels::andParity(words, other.data(), wordsCount);
+    }
+
+    /// @brief Finds the first set bit starting from the position
+    /// @param pos Zero-based bit index to start the search from
+    /// @return the index of the set bit or size() if there is no one
+    std::size_t findFirst(std::size_t pos = 0) const
+    {
+        return std::min(kernels::findFirstSet(words, wordsCount, pos),
+                        bitCount);
+    }
+
+    /// @brief Word-level access to the row
+    W *data() const
+    {
+        return words;
+    }
+
+    /// @brief Returns the number of the words processed by the row operations
+    std::size_t wordCount() const
+    {
+        return wordsCount;
+    }
+
+private:
+    W *words;
+    std::size_t bitCount;
+    std::size_t wordsCount;
+};
+
+using BitRow = BasicBitRow<kernels::Word>;
+using ConstBitRow = BasicBitRow<const kernels::Word>;
+
+/// @brief Dense bit matrix stored in a single aligned allocation.
+/// Every row starts at the cache line boundary and is padded to the
+/// whole number of the cache lines, so the rows fit the SIMD kernels.
+/// The rows are accessed through the permutation array, so swapping
+/// two rows only swaps their indices
+class BitMatrix
+{
+public:
+    using Word = kernels::Word;
+    static constexpr std::size_t alignment = 64;
+    static constexpr std::size_t lineWords = alignment / sizeof(Word);
+
+    /// @brief BitMatrix constructor. All the bits are cleared
+    /// @param rowsCount The number of the rows
+    /// @param bitsCount The number of the bits in a row
+    /// @param hugePages Requests the huge pages backing for the storage
+    /// where the platform supports it
+    BitMatrix(std::size_t rowsCount,
+              std::size_t bitsCount,
+              bool hugePages = false);
+
+    /// @brief BitMatrix constructor storing the rows in the shared mapping
+    /// of the scratch file, so the pages of the matrix are written back to
+    /// the file instead of taking the memory. The file is removed right
+    /// after the mapping and disappears with the matrix. Falls back to the
+    /// memory storage where the platform doesn't support it
+    /// @param rowsCount The number of the rows
+    /// @param bitsCount The number of the bits in a row
+    /// @param scratchDirectory The directory of the scratch file, the empty
+    /// path for the temporary directory
+    /// @throws std::filesystem::filesystem_error if the temporary directory
+    /// can't be resolved
+    BitMatrix(std::size_t rowsCount,
+              std::size_t bitsCount,
+              const std::filesystem::path &scratchDirectory);
+
+    /// @brief BitMatrix constructor viewing the rows stored in the external
+    /// memory, e.g. mapped from a file. The matrix doesn't own the words,
+    /// which have to outlive it and to follow the layout of the matrix
+    /// of the same size. The view is read-only, the words are never written
+    /// @param words The words of the rows aligned to the alignment
+    /// @param rowsCount The number of the rows
+    /// @param bitsCount The number of the bits in a row
+    BitMatrix(const Word *words, std::size_t rowsCount, std::size_t bitsCount);
+
+    BitMatrix(BitMatrix &&) noexcept = default;
+    BitMatrix &operator=(BitMatrix &&) noexcept = default;
+
+    /// @brief Returns the view of the row
+    /// @param i Zero-based row index
+    BitRow operator[](std::size_t i)
+    {
+        return {rowData(i), cols, stride};
+    }
+
+    /// @brief Returns the read-only view of the row
+    /// @param i Zero-based row index
+    ConstBitRow operator[](std::size_t i) const
+    {
+        return {rowData(i), cols, stride};
+    }
+
+    /// @brief Returns the words of the row
+    /// @param i Zero-based row index
+    Word *rowData(std::size_t i)
+    {
+        return storage.get() + order[i] * stride;
+    }
+
+    /// @brief Returns the words of the row
+    /// @param i Zero-based row index
+    const Word *rowData(std::size_t i) const
+    {
+        return storage.get() + order[i] * stride;
+    }
+
+    /// @brief Returns the words of the row in the storage order,
+    /// i.e. ignoring the rows permutation
+    /// @param p Zero-based index of the row in the storage
+    Word *storageRow(std::size_t p)
+    {
+        return storage.get() + p * stride;
+    }
+
+    /// @brief Returns the storage index of the row
+    /// @param i Zero-based row index
+    std::size_t storageIndex(std::size_t i) const
+    {
+        return order[i];
+    }
+
+    /// @brief Swaps the rows updating the permutation array only
+    void swapRows(std::size_t i, std::size_t j)
+    {
+        std::swap(order[i], order[j]);
+    }
+
+    /// @brief Returns the number of the rows
+    std::size_t size() const
+    {
+        return order.size();
+    }
+
+    /// @brief Returns the number of the bits in a row
+    std::size_t columns() const
+    {
+        return cols;
+    }
+
+    /// @brief Returns the distance between the rows in words
+    std::size_t rowStride() const
+    {
+        return stride;
+    }
+
+    /// @brief Returns the distance between the rows in words
+    /// for the rows of the bits count
+    static std::size_t strideFor(std::size_t bitsCount);
+
+    /// @brief Clears all the bits keeping the rows order
+    void reset();
+
+    /// @brief Iterator over the read-only row views
+    class ConstIterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ConstBitRow;
+        using difference_type = std::ptrdiff_t;
+
+        ConstIterator(const BitMatrix &matrix, std::size_t i)
+            : m(&matrix), row(i)
+        {
+        }
+
+        ConstBitRow operator*() const
+        {
+            return (*m)[row];
+        }
+
+        ConstIterator &operator++()
+        {
+            row++;
+            return *this;
+        }
+
+        bool operator==(const ConstIterator &other) const = default;
+
+    private:
+        const BitMatrix *m;
+        std::size_t row;
+    };
+
+    ConstIterator begin() const
+    {
+        return {*this, 0};
+    }
+
+    ConstIterator end() const
+    {
+        return {*this, size()};
+    }
+
+private:
+    /// @brief Releases the storage allocated either with the aligned
+    /// operator new or with the anonymous memory mapping.
+    /// The external storage isn't owned and isn't released
+    struct Deleter
+    {
+        std::size_t bytes;
+        bool mapped;
+        bool owned;
+
+        void operator()(Word *words) const;
+    };
+
+    // the number of the bits in a row and the words between the rows
+    std::size_t cols, stride;
+    std::unique_ptr<Word[], Deleter> storage;
+    // the storage row of every logical row
+    std::vector<std::size_t> order;
+
+    /// @brief Allocates the zeroed storage
+    static std::unique_ptr<Word[], Deleter> allocate(std::size_t bytes,
+                                                     bool hugePages);
+};
+} // namespace SecureBoxHack
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef BlockLanczos_h
+#define BlockLanczos_h
+
+#include "BitKernels.h"
+#include "DynamicBitset.h"
+#include <functional>
+
+namespace SecureBoxHack
+{
+namespace lanczos
+{
+// the number of the vectors processed at once, one per bit of the word
+inline constexpr std::size_t blockWidth = sizeof(kernels::Word) * 8;
+
+/// @brief The block of the 64 vectors of the N bits. The word r holds
+/// the bit r of every vector, so the block is an N x 64 matrix
+using Block = std::vector<kernels::Word>;
+
+/// @brief The symmetric N x N matrix over GF(2) applied to the blocks
+/// without materializing it: out = A * in. The out block has the size
+/// of the in block and isn't expected to be cleared
+using SymmetricOperator = std::function<void(const Block &in, Block &out)>;
+
+/// @brief The result of the solve
+enum class Outcome
+{
+    // the solution satisfies the system
+    Solved,
+    // the null space vector orthogonal to the right side was found,
+    // so the system has no solution
+    Unsolvable,
+    // no attempt has converged to the solution nor to the proof
+    // of unsolvability
+    Failed
+};
+
+/// @brief Solves A * x = b over GF(2) with the Montgomery block Lanczos
+/// algorithm for the symmetric matrix A.
+///
+/// The iteration builds the A-orthogonal basis of the Krylov space of
+/// V0 = A * Y + b, where Y is the random block and b is added into its
+/// first column, and accumulates X with A * X = V0. Every iteration costs
+/// a single application of the operator and a few O(N) block products,
+/// the whole solve takes about N / 63 iterations and O(N) memory.
+/// The singular A stops the iteration with V^T * A * V = 0 for the last V,
+/// so the solution and the null space vectors are combined from X + Y and
+/// the last V with the dense elimination of their 128 images.
+/// The method is probabilistic, the failed attempt is repeated with
+/// the new random block
+/// @param a The operator of the symmetric matrix
+/// @param b The right side of the system
+/// @param x Receives the solution of the size of b
+/// @param seed The seed of the random blocks
+/// @param attempts The number of the attempts with the different blocks
+/// @return the outcome of the solve
+Outcome solve(const SymmetricOperator &a,
+              const DynamicBitset &b,
+              DynamicBitset &x,
+              uint64_t seed = 0,
+              std::size_t attempts = 4);
+} // namespace lanczos
+} // namespace SecureBoxHack
+
+#endif
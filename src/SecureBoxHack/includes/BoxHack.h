@@ -2,36 +2,99 @@
 #define BoxHack_h
 
 #include "DynamicBitset.h"
+#include "OutOfCoreElimination.h"
 #include "types.h"
+#include <span>
 
 namespace SecureBoxHack
 {
+/// @brief The algorithm converting the Gauss matrix into the echelon form
+enum class EliminationEngine
+{
+    // pivot by pivot elimination of the rows one by one
+    Naive,
+    // Method of Four Russians eliminating the k-column strips at once
+    FourRussians,
+    // pivot by pivot elimination sharing the rows between the threads
+    // of the ThreadPool::shared() pool
+    Parallel,
+    // panel elimination of the matrix kept in the scratch file,
+    // see elimination::OutOfCoreOptions
+    OutOfCore,
+    // the engine recorded for the shape by Planner::shared(), which times
+    // the others on the first solve of the shape
+    Auto
+};
+
 /// @brief Helper class unlocking the SecureBox
 class BoxHack
 {
 public:
     /// @brief BoxHack constructor
-    /// @param initialState The initial state of the box
-    BoxHack(const BoolMatrix &initialState)
-        : state(initialState), y(initialState.size()),
-          x(initialState[0].size()),
-          m(initialState.size() * initialState[0].size(),
-            DynamicBitset(initialState.size() * initialState[0].size() + 1))
-    {
-    }
+    /// @param initialState The initial state of the box. It isn't referenced
+    /// after the construction
+    /// @param elimination The algorithm used for the Gauss matrix elimination
+    /// @param minimizeToggles Searches the null space of the toggle matrix
+    /// for the solution with less toggles instead of the free unknowns
+    /// set to 0
+    /// @param outOfCore The scratch directory and the memory budget
+    /// of the OutOfCore engine
+    BoxHack(const BoolMatrix &initialState,
+            EliminationEngine elimination = EliminationEngine::Naive,
+            bool minimizeToggles = false,
+            const elimination::OutOfCoreOptions &outOfCore = {});
+
+    /// @brief BoxHack constructor reading the packed state without copying.
+    /// The set bits are scattered straight into the Gauss matrix,
+    /// so the state isn't referenced after the construction
+    /// @param packedState The row-major bitmap of the state, the cell (i, j)
+    /// is the bit i * width + j, see helpers::packState()
+    /// @param height The number of the rows of the box
+    /// @param width The number of the columns of the box
+    /// @param elimination The algorithm used for the Gauss matrix elimination
+    /// @param minimizeToggles Searches the null space for the solution
+    /// with less toggles
+    /// @param outOfCore The scratch directory and the memory budget
+    /// of the OutOfCore engine
+    BoxHack(std::span<const uint64_t> packedState,
+            uint32_t height,
+            uint32_t width,
+            EliminationEngine elimination = EliminationEngine::Naive,
+            bool minimizeToggles = false,
+            const elimination::OutOfCoreOptions &outOfCore = {});
 
     /// @brief Hacks the SecureBox and returns the vector of tupples
     /// of the toggles that should be applied in order to unlock it
     /// @return vector of tupples representing (y, x) coordinates for toggle
-    std::vector<std::tuple<uint32_t, uint32_t>> getUnlockSequence();
+    ToggleSequence getUnlockSequence();
+
+    /// @brief Returns false if the state can't be unlocked. The parity
+    /// invariants are checked by the constructor, so it's known before
+    /// getUnlockSequence() is called
+    bool isSolvable() const;
 
 private:
-    // SeureBox initial lock state
-    const BoolMatrix &state;
     // SecureBox dimentions
     const std::size_t y, x;
-    // container for the generated Gaussian matrix of linear equations
+    // whether the state passes solvability::isSolvable() and then whether
+    // the last solution satisfies every equation. The rejected state
+    // isn't eliminated at all
+    bool solvable;
+    // the algorithm used for the Gauss matrix elimination. Auto is resolved
+    // before the Gauss matrix is allocated, so the planner's trial solves
+    // don't share the memory with it
+    const EliminationEngine engine;
+    // container for the generated Gaussian matrix of linear equations,
+    // empty for the rejected state
     GaussMatrix m;
+    // whether the number of the toggles is minimized
+    const bool minimize;
+    // the memory budget of the OutOfCore engine
+    const std::size_t outOfCoreBudget;
+
+protected:
+    // The phases of getUnlockSequence(), they are called one by one
+    // by the benchmarks to time them separately
 
     /// @brief Generates the Gaussian Elimination Matrix
     /// Each row of this matrix represents the toggle effect of a single cell,
@@ -39,17 +102,35 @@ private:
     /// The last column shows the initial lock value of the cell
     void buildGaussMatrix();
 
-    /// @brief Fills the row of the Gauss matrix
-    /// @param row The row to be filled
-    /// @param rowI Zero based index of the row in the matrix
-    void fillGaussRow(DynamicBitset &row, std::size_t rowI);
-
     /// @brief Adds the initial lock state into the last column of the Gauss matrix
-    void fillInitialState();
+    /// @param packedState The row-major bitmap of the state
+    void fillInitialState(std::span<const uint64_t> packedState);
 
     /// @brief Converts the Gauss matrix into the echelon form
     /// for solvind the liniar equations set
     void echelonGaussMatrix();
+
+    /// @brief Solves the echelon form from the last row to the first one.
+    /// The solution is kept bit-packed, so every unknown is computed
+    /// with a single word-wide dot product of its row and the solution.
+    /// The unknowns of the rows without pivot are free and set to 0
+    /// @param solution The cleared row of the Gauss matrix size receiving
+    /// the solution
+    /// @return false if some equation can't be satisfied
+    bool backSubstitute(BitRow solution) const;
+
+private:
+    /// @brief Fills the row of the Gauss matrix
+    /// @param row The row to be filled
+    /// @param rowI Zero based index of the row in the matrix
+    void fillGaussRow(BitRow row, std::size_t rowI);
+
+    /// @brief Builds the null space basis of the echelon form.
+    /// Every free unknown gives the basis row with the unknown set to 1,
+    /// the rest of the free unknowns set to 0 and the pivot unknowns solved
+    /// by the back substitution of the zero right side
+    /// @return the matrix of the basis rows of the Gauss matrix size
+    BitMatrix buildNullBasis() const;
 };
 } // namespace SecureBoxHack
 
@@ -0,0 +1,64 @@
+#ifndef BoxState_h
+#define BoxState_h
+
+#include "BitMatrix.h"
+#include "types.h"
+
+namespace SecureBoxHack
+{
+/// @brief Bit-packed simulator of the SecureBox state.
+///
+/// The toggles have the same effect as SecureBox::toggle(): the row and
+/// the column of the cell are flipped and the cell itself is flipped too.
+/// The effect of the toggles commutes, so the whole sequence is applied
+/// through the parities of the toggles in every row R and every column C:
+///     s(i, j) ^= R(i) ^ C(j) ^ t(i, j)
+/// where t is flipped in place for every toggle. It takes O(k + y * x / 64)
+/// for k toggles instead of O(k * (y + x)) of the replay
+class BoxState
+{
+public:
+    /// @brief BoxState constructor of the unlocked box
+    /// @param height The number of the rows of the box
+    /// @param width The number of the columns of the box
+    BoxState(uint32_t height, uint32_t width);
+
+    /// @brief BoxState constructor packing the state
+    /// @param state The state of the box, e.g. SecureBox::getState()
+    explicit BoxState(const BoolMatrix &state);
+
+    /// @brief Toggles the cell the same way SecureBox::toggle() does
+    /// @param posY The row of the cell
+    /// @param posX The column of the cell
+    void toggle(uint32_t posY, uint32_t posX);
+
+    /// @brief Applies the whole toggle sequence at once
+    /// @param toggles The (y, x) coordinates of the toggles
+    void apply(const ToggleSequence &toggles);
+
+    /// @brief Returns true if any cell of the box is locked
+    bool isLocked() const;
+
+    /// @brief Returns the state of the cell
+    bool test(uint32_t posY, uint32_t posX) const;
+
+    /// @brief Returns the state in the SecureBox::getState() format
+    BoolMatrix getState() const;
+
+    /// @brief Returns the number of the rows of the box
+    uint32_t height() const;
+
+    /// @brief Returns the number of the columns of the box
+    uint32_t width() const;
+
+private:
+    // SecureBox dimentions
+    uint32_t y, x;
+    // the row i holds the cells of the row i of the box
+    BitMatrix cells;
+    // the single row with the x bits set, the mask of the row flip
+    BitMatrix ones;
+};
+} // namespace SecureBoxHack
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef Cancellation_h
+#define Cancellation_h
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+namespace SecureBoxHack
+{
+/// @brief Thrown by the checkpoint of the solve stopped by its
+/// cancellation token or its deadline
+class SolveStopped : public std::runtime_error
+{
+public:
+    enum class Reason
+    {
+        Cancelled,
+        DeadlineExceeded
+    };
+
+    explicit SolveStopped(Reason stopReason);
+
+    /// @brief Returns why the solve was stopped
+    Reason reason() const;
+
+private:
+    Reason why;
+};
+
+/// @brief Shared flag requesting the solves to stop. The copies share
+/// the flag, so the token is cancelled from any thread holding a copy
+class CancellationToken
+{
+public:
+    CancellationToken();
+
+    /// @brief Requests the solves checking the token to stop
+    void cancel() const;
+
+    /// @brief Returns true if cancel() was called on any copy
+    bool isCancelled() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+namespace cancellation
+{
+using Clock = std::chrono::steady_clock;
+
+// the pivots eliminated between the checkpoints of the pivot by pivot
+// engines, so the checks cost nothing next to the row updates
+inline constexpr std::size_t pivotBlock = 64;
+
+/// @brief The condition stopping the solves of the thread
+struct StopCondition
+{
+    CancellationToken token{};
+    // the solve is stopped after the time point
+    Clock::time_point deadline = Clock::time_point::max();
+
+    /// @brief Returns the reason to stop, std::nullopt if the solve
+    /// may go on
+    std::optional<SolveStopped::Reason> check() const;
+};
+
+/// @brief Installs the stop condition checked by the eliminations running
+/// on the calling thread and restores the previous one on the destruction.
+/// The condition has to outlive the scope
+class Scope
+{
+public:
+    explicit Scope(const StopCondition &condition);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const StopCondition *previous;
+};
+
+/// @brief Returns the stop condition installed on the calling thread,
+/// nullptr if there is none
+const StopCondition *installed();
+
+/// @brief Returns true if the stop condition of the calling thread is met.
+/// Costs a thread-local load if there is no condition installed
+bool stopRequested();
+
+/// @brief Throws SolveStopped if the stop condition of the calling thread
+/// is met. Called by the eliminations between the blocks of the pivots
+void checkpoint();
+} // namespace cancellation
+} // namespace SecureBoxHack
+
+#endif
@@ -1,10 +1,12 @@
 #ifndef DynamicBitset_h
 #define DynamicBitset_h
 
+#include "BitKernels.h"
 #include <algorithm>
-#include <functional>
 #include <iostream>
+#include <stdexcept>
 #include <stdint.h>
+#include <tuple>
 #include <vector>
 
 namespace SecureBoxHack
@@ -71,14 +73,31 @@ public:
     /// @return the left-hand-side operand
     inline DynamicBitset &operator^=(const DynamicBitset &other)
     {
-        std::transform(dbs.begin(),
-                       dbs.end(),
-                       other.dbs.begin(),
-                       dbs.begin(),
-                       std::bit_xor());
+        checkSize(other);
+        kernels::xorWords(dbs.data(), other.dbs.data(), dbs.size());
         return *this;
     }
 
+    /// @brief Returns the parity of the bits set in both bitsets,
+    /// i.e. the dot product of the bitsets over GF(2).
+    /// Throws the exaption if the size of the bitsets isn't equal
+    /// @param other DinamicBitset instance of the same size
+    /// @return true if the number of the common bits is odd
+    inline bool andParity(const DynamicBitset &other) const
+    {
+        checkSize(other);
+        return kernels::andParity(dbs.data(), other.dbs.data(), dbs.size());
+    }
+
+    /// @brief Finds the first set bit starting from the position
+    /// @param pos Zero-based bit index to start the search from
+    /// @return the index of the set bit or size() if there is no one
+    inline std::size_t findFirst(std::size_t pos = 0) const
+    {
+        return std::min(kernels::findFirstSet(dbs.data(), dbs.size(), pos),
+                        _s);
+    }
+
     friend inline std::ostream &helpers::operator<<(std::ostream &os,
                                                     const DynamicBitset &bs);
 
@@ -88,6 +107,14 @@ private:
     // Bitset size
     std::size_t _s;
 
+    /// @brief Throws the exeption if the bitsets sizes differ
+    /// @param other DinamicBitset instance to be compared with
+    inline void checkSize(const DynamicBitset &other) const
+    {
+        if (_s != other._s)
+            throw std::invalid_argument("DynamicBitset sizes mismatch");
+    }
+
     /// @brief Returns the bit position as the container ID and the shift inside the container
     /// @param i Zero based bit position
     /// @return the tuple of elements {ontainer ID, bit offset}
@@ -0,0 +1,88 @@
+#ifndef Factorization_h
+#define Factorization_h
+
+#include "BitMatrix.h"
+#include "types.h"
+#include <memory>
+
+namespace SecureBoxHack
+{
+/// @brief Solver artifacts of the toggle matrix of a box shape.
+///
+/// The toggle matrix A only depends on the box dimensions, so it's
+/// eliminated once into the reduced row echelon form of [A | I].
+/// The right half gives the pseudo-inverse P choosing 0 for every free
+/// unknown and the basis of the null space. A is symmetric, so its null
+/// space is orthogonal to the states which can be unlocked.
+/// A solve is then O(N^2 / 64) for N = y * x instead of O(N^3 / 64):
+///     the state s can be unlocked if K * s = 0 for the null space basis K
+///     the toggles are t = P * s
+class Factorization
+{
+public:
+    /// @brief Factorization constructor eliminating the toggle matrix
+    /// @param height The number of the rows of the box
+    /// @param width The number of the columns of the box
+    Factorization(uint32_t height, uint32_t width);
+
+    /// @brief Factorization constructor adopting the precomputed artifacts,
+    /// e.g. loaded from the store
+    /// @param height The number of the rows of the box
+    /// @param width The number of the columns of the box
+    /// @param pseudoInverse The y * x rows of the pseudo-inverse
+    /// @param nullSpace The rows of the null space basis
+    /// @param storage The owner of the memory viewed by the matrices
+    Factorization(uint32_t height,
+                  uint32_t width,
+                  BitMatrix pseudoInverse,
+                  BitMatrix nullSpace,
+                  std::shared_ptr<const void> storage = nullptr);
+
+    /// @brief Returns the number of the rows of the box
+    uint32_t height() const;
+
+    /// @brief Returns the number of the columns of the box
+    uint32_t width() const;
+
+    /// @brief Returns the rank of the toggle matrix
+    std::size_t rank() const;
+
+    /// @brief Returns the number of the bytes used by the artifacts
+    std::size_t memoryUsage() const;
+
+    /// @brief Returns the pseudo-inverse of the toggle matrix. The row i
+    /// holds the state cells whose parity gives the toggle of the cell i
+    const BitMatrix &pseudoInverse() const;
+
+    /// @brief Returns the basis of the null space of the toggle matrix.
+    /// Every row is a set of the toggles leaving the box unchanged
+    const BitMatrix &nullSpace() const;
+
+    /// @brief Finds the toggles unlocking the packed state
+    /// @param state The row-major state of y * x bits. The row has to
+    /// have at least as many words as the pseudoInverse() rows
+    /// @param solution The row of the same size receiving the toggles
+    /// @return false if the state can't be unlocked
+    bool solve(ConstBitRow state, BitRow solution) const;
+
+    /// @brief Returns the vector of tupples of the toggles that should be
+    /// applied in order to unlock the state
+    /// @param state The state of the box of the factorized shape
+    /// @param minimize Searches the null space for the solution with less
+    /// toggles, see minimization::minimizeToggles()
+    /// @return vector of tupples representing (y, x) coordinates for toggle.
+    /// The vector is empty if the state can't be unlocked
+    ToggleSequence getUnlockSequence(const BoolMatrix &state,
+                                     bool minimize = false) const;
+
+private:
+    // SecureBox dimentions
+    uint32_t y, x;
+    std::size_t n, r;
+    // keeps the external memory of the matrices alive
+    std::shared_ptr<const void> backing;
+    BitMatrix inverse, nullBasis;
+};
+} // namespace SecureBoxHack
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef FactorizationCache_h
+#define FactorizationCache_h
+
+#include "Factorization.h"
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace SecureBoxHack
+{
+/// @brief Thread-safe cache of the factorizations keyed by the box shape.
+/// The least recently used factorizations are evicted when the memory
+/// budget is exceeded. The factorizations are shared, so the evicted one
+/// stays alive while somebody is using it
+class FactorizationCache
+{
+public:
+    // the default memory budget of the cache
+    static constexpr std::size_t defaultBudget = std::size_t{256} << 20;
+
+    /// @brief FactorizationCache constructor
+    /// @param budgetBytes The memory budget for the cached factorizations
+    explicit FactorizationCache(std::size_t budgetBytes = defaultBudget);
+
+    /// @brief Returns the factorization of the shape building it on miss.
+    /// The factorization is loaded from the store directory if the shape
+    /// is stored there and built otherwise. The factorization is built
+    /// outside the lock, so the concurrent misses of the same shape
+    /// may build it more than once
+    /// @param y The number of the rows of the box
+    /// @param x The number of the columns of the box
+    std::shared_ptr<const Factorization> get(uint32_t y, uint32_t x);
+
+    /// @brief Sets the new memory budget evicting the factorizations
+    /// which don't fit into it
+    void setBudget(std::size_t budgetBytes);
+
+    /// @brief Sets the directory of the files written by store::save().
+    /// The empty path disables the loading from the store
+    void setStoreDirectory(std::filesystem::path directory);
+
+    /// @brief Returns the memory budget in bytes
+    std::size_t budget() const;
+
+    /// @brief Returns the memory used by the cached factorizations
+    std::size_t memoryUsage() const;
+
+    /// @brief Returns the number of the cached shapes
+    std::size_t size() const;
+
+    /// @brief Checks whether the shape is cached without updating its use
+    bool contains(uint32_t y, uint32_t x) const;
+
+    /// @brief Removes all the cached factorizations
+    void clear();
+
+    /// @brief Returns the cache shared by the solvers
+    static FactorizationCache &shared();
+
+private:
+    using Key = uint64_t;
+
+    struct Entry
+    {
+        std::shared_ptr<const Factorization> value;
+        // position in the usage list
+        std::list<Key>::iterator use;
+    };
+
+    mutable std::mutex mutex;
+    std::size_t limit, used;
+    // the most recently used shapes first
+    std::list<Key> uses;
+    std::unordered_map<Key, Entry> entries;
+    // the directory of the stored factorizations
+    std::filesystem::path storeDirectory;
+
+    static Key toKey(uint32_t y, uint32_t x);
+
+    /// @brief Loads the factorization from the store or builds it
+    /// if it isn't stored or can't be loaded
+    std::shared_ptr<const Factorization> build(uint32_t y, uint32_t x) const;
+
+    /// @brief Evicts the least recently used entries exceeding the budget.
+    /// The mutex is expected to be locked
+    void evict();
+};
+} // namespace SecureBoxHack
+
+#endif
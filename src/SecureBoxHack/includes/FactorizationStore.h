@@ -0,0 +1,50 @@
+#ifndef FactorizationStore_h
+#define FactorizationStore_h
+
+#include "Factorization.h"
+#include <filesystem>
+#include <memory>
+
+namespace SecureBoxHack
+{
+/// @brief On-disk store of the factorizations of the box shapes.
+///
+/// A file holds the factorization of a single shape:
+///     the 64 bytes header: magic, format version, word size, box shape,
+///         rank, row stride in words and the checksum of the contents
+///     the y * x rows of the pseudo-inverse
+///     the y * x - rank rows of the null space basis
+/// The rows are stored in the BitMatrix layout, every row starts at the
+/// cache line boundary, so the file is mapped into memory and used by the
+/// solvers without copying. The mapping is read-only and shared, so the
+/// processes loading the same file share its pages.
+/// The words are stored in the native byte order
+namespace store
+{
+// the version of the file format, bumped on every layout change
+inline constexpr uint32_t formatVersion = 1;
+
+/// @brief Returns the name of the file of the shape in the store directory
+/// @param y The number of the rows of the box
+/// @param x The number of the columns of the box
+std::filesystem::path fileName(uint32_t y, uint32_t x);
+
+/// @brief Writes the factorization into the file. The file is written
+/// next to the destination and renamed, so the readers never see it
+/// partially written
+/// @param factorization The factorization to be stored
+/// @param path The path of the file
+void save(const Factorization &factorization,
+          const std::filesystem::path &path);
+
+/// @brief Loads the factorization mapping the file into memory.
+/// Throws std::runtime_error if the file can't be read or is corrupted
+/// @param path The path of the file
+/// @param verify Verifies the checksum of the contents. The verification
+/// reads the whole file instead of the pages touched by the solves
+std::shared_ptr<const Factorization> load(const std::filesystem::path &path,
+                                          bool verify = true);
+} // namespace store
+} // namespace SecureBoxHack
+
+#endif
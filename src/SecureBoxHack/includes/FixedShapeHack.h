@@ -0,0 +1,244 @@
+#ifndef FixedShapeHack_h
+#define FixedShapeHack_h
+
+#include "BoxHack.h"
+#include "types.h"
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <span>
+
+namespace SecureBoxHack
+{
+namespace fixed
+{
+/// @brief The row-major bitmap of the y * x cells kept on the stack
+template <std::size_t Bits>
+using Bitset = std::array<uint64_t, (Bits + 63) / 64>;
+
+/// @brief The solver tables of the shape, see factorize()
+template <std::size_t Y, std::size_t X>
+struct Tables
+{
+    static constexpr std::size_t size = Y * X;
+    using Row = Bitset<size>;
+
+    // the row k selects the state cells whose XOR gives the toggle k
+    std::array<Row, size> inverse{};
+    // the state is unlockable only if it has the even number of cells
+    // in common with every check. The null space of the toggle matrix
+    // has y + x - 2 dimensions at most
+    std::array<Row, Y + X> checks{};
+    std::size_t checkCount = 0;
+};
+
+/// @brief Builds the solver tables of the shape at compile time.
+///
+/// The toggles t solve A * t = s if and only if
+///     t(i, j) = s(i, j) ^ R(i) ^ C(j)
+/// for the parities R of the rows and C of the columns of t. Summing it
+/// over the row i and over the column j gives the system of y + x unknowns
+///     (x + 1) * R(i) ^ sum(C) = S(i)
+///     (y + 1) * C(j) ^ sum(R) = SC(j)
+/// for the parities S and SC of the rows and the columns of the state.
+/// The small system is reduced by Gauss-Jordan keeping the right sides as
+/// the masks of the state cells, so every pivot gives R(i) or C(j) as
+/// the XOR of the state cells and every row without the pivot gives
+/// the check. The free parities are set to 0. The row of the pseudo-inverse
+/// is the cell itself and the masks of its row and its column. It keeps
+/// the compile time O(y * x * (y + x)) instead of O((y * x)^3) of the
+/// elimination of the whole toggle matrix
+template <std::size_t Y, std::size_t X>
+constexpr Tables<Y, X> factorize()
+{
+    constexpr std::size_t k = Y + X;
+    using Row = typename Tables<Y, X>::Row;
+    const auto set = [](Row &row, std::size_t bit) {
+        row[bit / 64] ^= uint64_t{1} << (bit % 64);
+    };
+
+    // the coefficients of the parities R(0..y-1), C(0..x-1)
+    // and the right sides
+    std::array<Bitset<k>, k> m{};
+    std::array<Row, k> rhs{};
+    for (std::size_t i = 0; i < Y; i++)
+    {
+        for (std::size_t j = 0; j < X; j++)
+        {
+            m[i][(Y + j) / 64] |= uint64_t{1} << ((Y + j) % 64);
+            set(rhs[i], i * X + j);
+        }
+        if (X % 2 == 0)
+            m[i][i / 64] |= uint64_t{1} << (i % 64);
+    }
+    for (std::size_t j = 0; j < X; j++)
+    {
+        for (std::size_t i = 0; i < Y; i++)
+        {
+            m[Y + j][i / 64] |= uint64_t{1} << (i % 64);
+            set(rhs[Y + j], i * X + j);
+        }
+        if (Y % 2 == 0)
+            m[Y + j][(Y + j) / 64] |= uint64_t{1} << ((Y + j) % 64);
+    }
+
+    // the mask of the parity, empty for the free ones
+    std::array<Row, k> parity{};
+    std::size_t rank = 0;
+    for (std::size_t c = 0; c < k && rank < k; c++)
+    {
+        const auto has = [&](const Bitset<k> &row) {
+            return (row[c / 64] >> (c % 64)) & 1;
+        };
+        std::size_t p = rank;
+        for (; p < k && !has(m[p]); p++)
+        {
+        }
+        if (p == k)
+            continue; // the parity is free
+
+        std::swap(m[p], m[rank]);
+        std::swap(rhs[p], rhs[rank]);
+        for (std::size_t r = 0; r < k; r++)
+            if (r != rank && has(m[r]))
+            {
+                for (std::size_t w = 0; w < m[r].size(); w++)
+                    m[r][w] ^= m[rank][w];
+                for (std::size_t w = 0; w < rhs[r].size(); w++)
+                    rhs[r][w] ^= rhs[rank][w];
+            }
+        rank++;
+    }
+
+    Tables<Y, X> tables;
+    for (std::size_t r = 0; r < k; r++)
+    {
+        std::size_t c = 0;
+        for (; c < k && !((m[r][c / 64] >> (c % 64)) & 1); c++)
+        {
+        }
+        if (c < k)
+            parity[c] = rhs[r];
+        else
+            tables.checks[tables.checkCount++] = rhs[r];
+    }
+
+    for (std::size_t i = 0; i < Y; i++)
+        for (std::size_t j = 0; j < X; j++)
+        {
+            Row &row = tables.inverse[i * X + j];
+            for (std::size_t w = 0; w < row.size(); w++)
+                row[w] = parity[i][w] ^ parity[Y + j][w];
+            set(row, i * X + j);
+        }
+    return tables;
+}
+
+/// @brief Solver of the single box shape. The tables are built
+/// at compile time, so the solve is an AND and a popcount per toggle
+/// without any allocation
+template <std::size_t Y, std::size_t X>
+class FixedHack
+{
+public:
+    static constexpr std::size_t size = Y * X;
+    static constexpr std::size_t words = (size + 63) / 64;
+    static constexpr Tables<Y, X> tables = factorize<Y, X>();
+
+    /// @brief Solves the packed state
+    /// @param packedState The row-major bitmap of the state,
+    /// see helpers::packState(). At least words long
+    /// @param toggles Receives the row-major bitmap of the toggles.
+    /// At least words long
+    /// @return false if the state can't be unlocked
+    static bool solve(std::span<const uint64_t> packedState,
+                      std::span<uint64_t> toggles)
+    {
+        for (std::size_t k = 0; k < tables.checkCount; k++)
+            if (parity(tables.checks[k], packedState))
+                return false;
+
+        for (std::size_t w = 0; w < words; w++)
+            toggles[w] = 0;
+        for (std::size_t k = 0; k < size; k++)
+            toggles[k / 64] |=
+                uint64_t{parity(tables.inverse[k], packedState)} << (k % 64);
+        return true;
+    }
+
+private:
+    static bool parity(const Bitset<size> &row,
+                       std::span<const uint64_t> packedState)
+    {
+        uint64_t product = 0;
+        for (std::size_t w = 0; w < words; w++)
+            product ^= row[w] & packedState[w];
+        return std::popcount(product) & 1;
+    }
+};
+
+// The shapes up to limit x limit are specialized by the library,
+// see the SECURE_BOX_FIXED_SHAPE_LIMIT CMake option
+#ifndef SECURE_BOX_FIXED_SHAPE_LIMIT
+#define SECURE_BOX_FIXED_SHAPE_LIMIT 16
+#endif
+inline constexpr std::size_t shapeLimit = SECURE_BOX_FIXED_SHAPE_LIMIT;
+
+// the largest bitmap of the specialized shapes
+using MaxBitset = Bitset<shapeLimit * shapeLimit>;
+
+/// @brief The solve() of the specialized shape
+using Solver = bool (*)(std::span<const uint64_t>, std::span<uint64_t>);
+
+/// @brief Returns the solver of the shape, nullptr if it isn't specialized
+Solver findSolver(std::size_t y, std::size_t x);
+} // namespace fixed
+
+/// @brief Helper class dispatching the box to the compile-time solver
+/// of its shape, see fixed::FixedHack. The rest of the shapes are passed
+/// to BoxHack
+class FixedShapeHack
+{
+public:
+    /// @brief FixedShapeHack constructor
+    /// @param initialState The initial state of the box
+    /// @param fallback The elimination of the shapes without the solver
+    FixedShapeHack(const BoolMatrix &initialState,
+                   EliminationEngine fallback = EliminationEngine::Naive);
+
+    /// @brief FixedShapeHack constructor of the packed state
+    /// @param packedState The row-major bitmap of the state,
+    /// see helpers::packState()
+    /// @param height The number of the rows of the box
+    /// @param width The number of the columns of the box
+    /// @param fallback The elimination of the shapes without the solver
+    FixedShapeHack(std::span<const uint64_t> packedState,
+                   uint32_t height,
+                   uint32_t width,
+                   EliminationEngine fallback = EliminationEngine::Naive);
+
+    /// @brief Hacks the SecureBox and returns the vector of tupples
+    /// of the toggles that should be applied in order to unlock it
+    /// @return vector of tupples representing (y, x) coordinates for toggle.
+    /// The vector of the specialized shape is empty if the state
+    /// can't be unlocked
+    ToggleSequence getUnlockSequence();
+
+    /// @brief Returns false if the last getUnlockSequence() call found
+    /// that the state can't be unlocked
+    bool isSolvable() const;
+
+    /// @brief Returns true if the shape is solved at compile time
+    static bool isSpecialized(std::size_t height, std::size_t width);
+
+private:
+    // SecureBox dimentions
+    const uint32_t y, x;
+    // the row-major packed lock state
+    const std::vector<uint64_t> packed;
+    const EliminationEngine engine;
+    bool solvable;
+};
+} // namespace SecureBoxHack
+
+#endif
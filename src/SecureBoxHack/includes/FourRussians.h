@@ -0,0 +1,42 @@
+#ifndef FourRussians_h
+#define FourRussians_h
+
+#include "types.h"
+
+namespace SecureBoxHack
+{
+namespace elimination
+{
+// the default number of the columns processed at once
+inline constexpr std::size_t fourRussiansStrip = 8;
+
+/// @brief Converts the augmented Gauss matrix into the echelon form using
+/// the Method of Four Russians (M4RI).
+/// The columns are processed in k-column strips. The pivot rows of a strip
+/// are reduced against each other and all 2^k of their combinations are
+/// stored in the Gray code table, so every other row is cleared in the whole
+/// strip with a single table lookup and a single row XOR.
+/// The result keeps the layout expected by the back substitution: the row i
+/// either has the pivot in the column i or has no coefficients at all
+/// @param m The augmented Gauss matrix with the N rows and N + 1 columns
+/// @param k The number of the columns in a strip
+void echelonFourRussians(GaussMatrix &m, std::size_t k = fourRussiansStrip);
+
+/// @brief Eliminates the leading columns of the matrix with the Method of
+/// Four Russians. The pivot rows are moved to the top of the matrix in the
+/// order of their columns, the remaining rows have no bits left in the
+/// leading columns. The rest of the columns are transformed along
+/// @param m The matrix to be eliminated
+/// @param columns The number of the leading columns to pivot on
+/// @param reduced true for the reduced row echelon form, i.e. clearing
+/// the pivot columns above the pivots as well
+/// @param k The number of the columns in a strip
+/// @return the pivot column of every pivot row, its size is the rank
+std::vector<std::size_t> reduceFourRussians(GaussMatrix &m,
+                                            std::size_t columns,
+                                            bool reduced,
+                                            std::size_t k = fourRussiansStrip);
+} // namespace elimination
+} // namespace SecureBoxHack
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef IncrementalHack_h
+#define IncrementalHack_h
+
+#include "BitMatrix.h"
+#include "DynamicBitset.h"
+#include "types.h"
+#include <span>
+
+namespace SecureBoxHack
+{
+/// @brief Solver session following the box state cell flip by cell flip.
+///
+/// The solution of StructuredHack only depends on the state through
+/// the row parities r(i) and the column parities c(j):
+///     t(i, j) = s(i, j) ^ R(i) ^ C(j)
+/// where R and C are derived from r, c and the parity T of the whole
+/// toggle set. A cell flip changes the single state bit, one row parity
+/// and one column parity, so the session only updates them together
+/// with the counts of the odd lines deciding the solvability. The flip
+/// takes O(1) instead of the full solve, the toggle bitmap is rebuilt
+/// lazily in O(y * x / 64) when it's requested after the flips.
+/// The solution is the same as StructuredHack gives for the current state
+class IncrementalHack
+{
+public:
+    /// @brief IncrementalHack constructor of the unlocked box
+    /// @param height The number of the rows of the box
+    /// @param width The number of the columns of the box
+    IncrementalHack(uint32_t height, uint32_t width);
+
+    /// @brief IncrementalHack constructor
+    /// @param initialState The initial state of the box. It isn't referenced
+    /// after the construction
+    explicit IncrementalHack(const BoolMatrix &initialState);
+
+    /// @brief IncrementalHack constructor reading the packed state
+    /// @param packedState The row-major bitmap of the state, see
+    /// helpers::packState()
+    /// @param height The number of the rows of the box
+    /// @param width The number of the columns of the box
+    IncrementalHack(std::span<const uint64_t> packedState,
+                    uint32_t height,
+                    uint32_t width);
+
+    /// @brief Flips the lock state of the single cell
+    /// @param posY The row of the cell
+    /// @param posX The column of the cell
+    void flip(uint32_t posY, uint32_t posX);
+
+    /// @brief Flips the lock state of the cells. The repeated flips
+    /// of the same cell cancel each other
+    /// @param flips The (y, x) coordinates of the flipped cells
+    void flip(const ToggleSequence &flips);
+
+    /// @brief Flips the lock state of the set cells of the row-major
+    /// bitmap, e.g. the XOR of the previous and the current packed states
+    /// @param packedChanges The bitmap of the helpers::packState() layout
+    void flip(std::span<const uint64_t> packedChanges);
+
+    /// @brief Checks whether the current state can be unlocked
+    bool isSolvable() const;
+
+    /// @brief Returns the toggles unlocking the current state, the row i
+    /// holds the toggles of the row i of the box. The bitmap is rebuilt
+    /// if the state was flipped since the last call. The rows are cleared
+    /// if the state can't be unlocked
+    const BitMatrix &solution();
+
+    /// @brief Returns the vector of tupples of the toggles that should be
+    /// applied in order to unlock the current state
+    /// @return vector of tupples representing (y, x) coordinates for toggle.
+    /// The vector is empty if the state can't be unlocked
+    ToggleSequence getUnlockSequence();
+
+    /// @brief Returns the current lock state of the cell
+    bool test(uint32_t posY, uint32_t posX) const;
+
+    /// @brief Returns the number of the rows of the box
+    uint32_t height() const;
+
+    /// @brief Returns the number of the columns of the box
+    uint32_t width() const;
+
+private:
+    // SecureBox dimentions
+    const uint32_t y, x;
+    // the current state, the row i holds the cells of the row i of the box
+    BitMatrix cells;
+    // the toggles of the current state, valid unless stale
+    BitMatrix toggles;
+    // the single row with the x bits set and the column toggles
+    // of the solution
+    BitMatrix ones, colToggles;
+    // parities of the locked cells in every row and every column
+    DynamicBitset rowParity, colParity;
+    // the number of the odd rows and the odd columns
+    std::size_t oddRows, oddCols;
+    // whether the state was flipped since the toggles were rebuilt
+    bool stale;
+
+    /// @brief Returns the parity of the total toggles count
+    bool totalToggles() const;
+};
+} // namespace SecureBoxHack
+
+#endif
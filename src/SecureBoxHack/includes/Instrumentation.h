@@ -0,0 +1,217 @@
+#ifndef Instrumentation_h
+#define Instrumentation_h
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// The instrumentation is removed completely when the macro is 0,
+// see the ENABLE_INSTRUMENTATION CMake option
+#ifndef SECURE_BOX_INSTRUMENTATION
+#define SECURE_BOX_INSTRUMENTATION 1
+#endif
+
+namespace SecureBoxHack
+{
+namespace instrumentation
+{
+inline constexpr bool enabled = SECURE_BOX_INSTRUMENTATION;
+
+/// @brief The timed phases of the solvers
+enum class Phase
+{
+    BuildGaussMatrix,
+    Elimination,
+    BackSubstitution,
+    Minimization,
+    Count
+};
+
+/// @brief The counters of the solvers
+enum class Counter
+{
+    // the solved boxes
+    Solves,
+    // the unknowns with the pivot in the echelon form
+    Pivots,
+    // the unknowns without the pivot, set to 0 or minimized
+    FreeVariables,
+    // the row XORs of the elimination
+    RowXors,
+    // the words read or written by the elimination
+    WordsTouched,
+    // the bytes of the BitMatrix storage allocated
+    BytesAllocated,
+    // the unsolvable states rejected before the elimination
+    EarlyRejects,
+    // the factorizations loaded from the store files
+    StoreLoads,
+    Count
+};
+
+inline constexpr std::size_t phaseCount =
+    static_cast<std::size_t>(Phase::Count);
+inline constexpr std::size_t counterCount =
+    static_cast<std::size_t>(Counter::Count);
+
+/// @brief The latency histogram of the phase. The bucket i counts
+/// the durations below 2^i microseconds, the last one counts the rest
+struct Histogram
+{
+    static constexpr std::size_t bucketCount = 32;
+
+    std::array<uint64_t, bucketCount> buckets{};
+    uint64_t count = 0;
+    uint64_t sumNanoseconds = 0;
+
+    /// @brief Returns the bucket of the duration
+    static std::size_t bucketOf(uint64_t nanoseconds);
+};
+
+/// @brief The totals of all the threads
+struct Snapshot
+{
+    std::array<uint64_t, counterCount> counters{};
+    std::array<Histogram, phaseCount> phases{};
+
+    uint64_t counter(Counter c) const
+    {
+        return counters[static_cast<std::size_t>(c)];
+    }
+
+    const Histogram &phase(Phase p) const
+    {
+        return phases[static_cast<std::size_t>(p)];
+    }
+};
+
+/// @brief Returns the snake_case name of the phase
+const char *phaseName(Phase phase);
+
+/// @brief Returns the snake_case name of the counter
+const char *counterName(Counter counter);
+
+/// @brief Formats the snapshot as the JSON object
+std::string toJson(const Snapshot &snapshot);
+
+/// @brief Formats the snapshot in the Prometheus text exposition format.
+/// The counters get the _total suffix, the phases make the single
+/// secret_box_phase_seconds histogram labeled by the phase
+std::string toPrometheus(const Snapshot &snapshot);
+
+#if SECURE_BOX_INSTRUMENTATION
+/// @brief Adds the value to the counter of the calling thread.
+/// Every thread keeps its own counters, so it's a plain increment
+/// without the locks or the shared cache lines
+void count(Counter counter, uint64_t value = 1);
+
+/// @brief Adds the duration to the histogram of the calling thread
+void record(Phase phase, std::chrono::nanoseconds duration);
+
+/// @brief Sums the counters and the histograms of all the threads,
+/// including the exited ones. It may run concurrently with the solvers
+Snapshot snapshot();
+
+/// @brief Clears the counters and the histograms of all the threads
+void reset();
+
+/// @brief Returns false while the calling thread is inside Suppression
+bool recording();
+
+/// @brief Stops the counting and the recording of the calling thread
+/// for the lifetime of the scope, e.g. for the trial solves of the planner.
+/// The scopes nest. The other threads aren't affected, so the work handed
+/// to them checks recording() of the caller
+class Suppression
+{
+public:
+    Suppression();
+    ~Suppression();
+
+    Suppression(const Suppression &) = delete;
+    Suppression &operator=(const Suppression &) = delete;
+};
+
+/// @brief Records the lifetime of the scope into the phase histogram
+class PhaseTimer
+{
+public:
+    explicit PhaseTimer(Phase timedPhase)
+        : phase(timedPhase), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~PhaseTimer()
+    {
+        record(phase, std::chrono::steady_clock::now() - start);
+    }
+
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+private:
+    const Phase phase;
+    const std::chrono::steady_clock::time_point start;
+};
+#else
+// the stubs are empty, so the calls are removed by the compiler
+
+inline void count(Counter, uint64_t = 1)
+{
+}
+
+inline void record(Phase, std::chrono::nanoseconds)
+{
+}
+
+inline Snapshot snapshot()
+{
+    return {};
+}
+
+inline void reset()
+{
+}
+
+inline bool recording()
+{
+    return false;
+}
+
+class Suppression
+{
+public:
+    Suppression()
+    {
+    }
+
+    Suppression(const Suppression &) = delete;
+    Suppression &operator=(const Suppression &) = delete;
+};
+
+class PhaseTimer
+{
+public:
+    explicit PhaseTimer(Phase)
+    {
+    }
+
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+};
+#endif
+
+/// @brief Counts the row XORs of the elimination and the words touched
+/// by them, every XOR reads two rows and writes one
+/// @param xors The number of the row XORs
+/// @param rowWords The number of the words in the row
+inline void countRowXors(uint64_t xors, std::size_t rowWords)
+{
+    count(Counter::RowXors, xors);
+    count(Counter::WordsTouched, xors * 3 * rowWords);
+}
+} // namespace instrumentation
+} // namespace SecureBoxHack
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef LanczosHack_h
+#define LanczosHack_h
+
+#include "BlockLanczos.h"
+#include "DynamicBitset.h"
+#include "types.h"
+
+namespace SecureBoxHack
+{
+/// @brief Helper class unlocking the SecureBox with the sparse iterative
+/// solver, for the boxes whose dense Gauss matrix doesn't fit into memory.
+///
+/// The toggle matrix A is never stored. A toggle of the cell (i, j) flips
+/// the row i and the column j, so the product of A and the block V is
+///     (A * V)(i, j) = R(i) ^ C(j) ^ V(i, j)
+/// for the XORs R of the rows and C of the columns of V, which takes O(y * x)
+/// word operations. A is symmetric, so the system is solved with the block
+/// Lanczos algorithm in O((y * x)^2 / 64) time and O(y * x) memory
+class LanczosHack
+{
+public:
+    /// @brief LanczosHack constructor
+    /// @param initialState The initial state of the box
+    /// @param randomSeed The seed of the random blocks of the solver
+    LanczosHack(const BoolMatrix &initialState, uint64_t randomSeed = 0);
+
+    /// @brief Hacks the SecureBox and returns the vector of tupples
+    /// of the toggles that should be applied in order to unlock it
+    /// @return vector of tupples representing (y, x) coordinates for toggle.
+    /// The vector is empty if the state can't be unlocked
+    ToggleSequence getUnlockSequence();
+
+    /// @brief Returns the outcome of the last getUnlockSequence() call
+    lanczos::Outcome outcome() const;
+
+    /// @brief Applies the toggle matrix of the box to the block
+    /// @param y The number of the rows of the box
+    /// @param x The number of the columns of the box
+    /// @param in The block of the y * x rows
+    /// @param out Receives A * in
+    static void applyToggles(std::size_t y,
+                             std::size_t x,
+                             const lanczos::Block &in,
+                             lanczos::Block &out);
+
+private:
+    // SecureBox dimentions
+    const std::size_t y, x;
+    // the row-major packed lock state
+    DynamicBitset state;
+    const uint64_t seed;
+    lanczos::Outcome result;
+};
+} // namespace SecureBoxHack
+
+#endif
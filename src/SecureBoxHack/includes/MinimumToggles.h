@@ -0,0 +1,32 @@
+#ifndef MinimumToggles_h
+#define MinimumToggles_h
+
+#include "BitMatrix.h"
+
+namespace SecureBoxHack
+{
+namespace minimization
+{
+// the largest null space searched through all its combinations
+inline constexpr std::size_t exhaustiveDimension = 20;
+
+/// @brief Returns the number of the set bits of the row
+std::size_t weight(ConstBitRow row);
+
+/// @brief Reduces the number of the toggles of the solution.
+/// Every solution of the system is the given one plus a combination of
+/// the null space basis. The combinations are searched exhaustively in
+/// the Gray code order, i.e. a single row XOR per combination, if the
+/// null space is small enough. Otherwise the greedy local search applies
+/// the basis rows and their pairs while they reduce the weight
+/// @param solution The solution to be minimized in place
+/// @param nullBasis The null space basis with the rows of the solution size
+/// @param exhaustiveLimit The largest dimension searched exhaustively
+/// @return the number of the toggles of the minimized solution
+std::size_t minimizeToggles(BitRow solution,
+                            const BitMatrix &nullBasis,
+                            std::size_t exhaustiveLimit = exhaustiveDimension);
+} // namespace minimization
+} // namespace SecureBoxHack
+
+#endif
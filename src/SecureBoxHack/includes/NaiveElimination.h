@@ -0,0 +1,94 @@
+#ifndef NaiveElimination_h
+#define NaiveElimination_h
+
+#include "types.h"
+#include <vector>
+
+namespace SecureBoxHack
+{
+namespace elimination
+{
+/// @brief How the pivot by pivot elimination finds the rows with the bit
+/// of the pivot column
+enum class PivotSearch
+{
+    // probes the column row by row, a cache line per row
+    Rows,
+    // scans the words of the column in the ColumnStrip
+    Columns
+};
+
+// the rows of the smallest matrix searched in the ColumnStrip, i.e. the boxes
+// of 512 cells such as 16x32 or 23x23. The smaller matrices stay in the cache,
+// so probing their rows is cheaper than the strip loads
+inline constexpr std::size_t columnSearchRows = 512;
+
+/// @brief Column-major copy of the 64-column strip of the Gauss matrix.
+///
+/// The strip is loaded by transposing the 64x64 blocks of the row words,
+/// so every column of the strip is the bitmap of the rows having the bit
+/// in the column. The rows with the bit are then found by countr_zero over
+/// the words of the column instead of probing the rows one by one, and
+/// the whole column, e.g. the right side, is read at the word speed.
+/// The copy follows the row swaps and the eliminations mirrored into it,
+/// the matrix itself isn't referenced after the load
+class ColumnStrip
+{
+public:
+    using Word = kernels::Word;
+    // the number of the columns in the strip
+    static constexpr std::size_t width = 64;
+
+    /// @brief ColumnStrip constructor
+    /// @param rowsCount The number of the rows of the matrix
+    explicit ColumnStrip(std::size_t rowsCount);
+
+    /// @brief Loads the columns [first, first + width) of all the rows
+    /// @param m The matrix
+    /// @param first The first column of the strip, a multiple of the width
+    void load(const GaussMatrix &m, std::size_t first);
+
+    /// @brief Returns the rows having the bit in the column of the strip
+    ConstBitRow column(std::size_t c) const;
+
+    /// @brief Finds the first row not less than from with the bit
+    /// in the column of the strip
+    /// @return the row index or the number of the rows if there is none
+    std::size_t findRow(std::size_t c, std::size_t from) const;
+
+    /// @brief Mirrors GaussMatrix::swapRows()
+    void swapRows(std::size_t i, std::size_t j);
+
+    /// @brief Mirrors the XOR of the pivot row into every row below it
+    /// with the bit in the pivot column
+    /// @param pivot The pivot row and column in the strip
+    /// @param pivotWord The word of the pivot row in the strip
+    void eliminate(std::size_t pivot, Word pivotWord);
+
+private:
+    std::size_t rows, words, first;
+    // the columns of the strip one after another, words each
+    std::vector<Word> columns;
+
+    Word *columnData(std::size_t c)
+    {
+        return columns.data() + (c - first) * words;
+    }
+
+    const Word *columnData(std::size_t c) const
+    {
+        return columns.data() + (c - first) * words;
+    }
+};
+
+/// @brief Converts the augmented Gauss matrix into the echelon form pivot
+/// by pivot. The first row with the bit of the column is swapped into
+/// the pivot position and XORed into every row below it with the bit.
+/// The row i either has the pivot in the column i or is left as it is
+/// @param m The augmented Gauss matrix with the N rows and N + 1 columns
+/// @param search How the rows with the bit of the pivot column are found
+void echelonNaive(GaussMatrix &m, PivotSearch search = PivotSearch::Columns);
+} // namespace elimination
+} // namespace SecureBoxHack
+
+#endif
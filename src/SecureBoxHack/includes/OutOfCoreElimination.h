@@ -0,0 +1,51 @@
+#ifndef OutOfCoreElimination_h
+#define OutOfCoreElimination_h
+
+#include "types.h"
+#include <filesystem>
+
+namespace SecureBoxHack
+{
+namespace elimination
+{
+/// @brief Settings of the out-of-core elimination
+struct OutOfCoreOptions
+{
+    // the directory of the scratch file keeping the Gauss matrix,
+    // the empty one is the temporary directory resolved by the matrix
+    std::filesystem::path scratchDirectory{};
+    // the memory for the pivot rows and the tables of a panel
+    std::size_t budgetBytes = std::size_t{256} << 20;
+};
+
+/// @brief The traffic between the elimination and the matrix storage
+struct OutOfCoreStats
+{
+    std::size_t bytesRead = 0;
+    std::size_t bytesWritten = 0;
+    std::size_t panels = 0;
+};
+
+/// @brief Converts the augmented Gauss matrix into the echelon form keeping
+/// only a panel of the pivot rows in memory. The matrix is expected to be
+/// backed by the scratch file, see the BitMatrix scratch constructor.
+///
+/// The columns are eliminated in panels, as many pivots per panel as fit
+/// into the memory budget. Every panel takes two sequential sweeps over
+/// the storage:
+///     the pivot sweep reads the panel columns of the rows only and keeps
+///         the pivot rows found in the reduced form in memory
+///     the update sweep clears the panel columns of the rest of the rows
+///         with the Gray code tables of the 4 pivots, from the first word
+///         of the panel on, since the rows are already zero before it
+/// The rows behind the sweeps are advised to be paged out.
+/// The result keeps the layout expected by the back substitution: the row i
+/// either has the pivot in the column i or has no coefficients at all
+/// @param m The augmented Gauss matrix with the N rows and N + 1 columns
+/// @param budgetBytes The memory for the pivot rows and the tables
+/// @return the traffic between the elimination and the storage
+OutOfCoreStats echelonOutOfCore(GaussMatrix &m, std::size_t budgetBytes);
+} // namespace elimination
+} // namespace SecureBoxHack
+
+#endif
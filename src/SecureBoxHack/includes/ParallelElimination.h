@@ -0,0 +1,26 @@
+#ifndef ParallelElimination_h
+#define ParallelElimination_h
+
+#include "ThreadPool.h"
+#include "types.h"
+
+namespace SecureBoxHack
+{
+namespace elimination
+{
+// the size of the rows block updated by a worker at once
+inline constexpr std::size_t parallelBlockBytes = 32 * 1024;
+
+/// @brief Converts the augmented Gauss matrix into the echelon form
+/// updating the rows below every pivot on all the threads of the pool.
+/// The first participant searches for the pivot, then the rows below it
+/// are split into the cache-sized blocks interleaved between the
+/// participants. All of them meet at the barrier before the next pivot.
+/// Produces the same matrix as the naive BoxHack elimination
+/// @param m The augmented Gauss matrix with the N rows and N + 1 columns
+/// @param pool The threads performing the rows update
+void echelonParallel(GaussMatrix &m, ThreadPool &pool);
+} // namespace elimination
+} // namespace SecureBoxHack
+
+#endif
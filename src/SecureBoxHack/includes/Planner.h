@@ -0,0 +1,136 @@
+#ifndef Planner_h
+#define Planner_h
+
+#include "BoxHack.h"
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace SecureBoxHack
+{
+/// @brief Thread-safe planner choosing the elimination engine of the shape.
+///
+/// The first solve of the shape with EliminationEngine::Auto times every
+/// candidate engine on the random unlockable state of the shape and records
+/// the fastest one, so the later solves of the shape dispatch to it at once.
+/// Every candidate is timed under the deadline of the fastest one so far,
+/// i.e. the slow engines are stopped early instead of running to the end.
+/// The trials keep the stop condition of the caller, whose cancellation
+/// or deadline fails the planning with SolveStopped and records nothing.
+/// The trials aren't counted by the instrumentation.
+/// The plans are kept as the wisdom keyed by the shape and by the host,
+/// which are the instruction set of the kernels, the threads of the shared
+/// pool and the cache sizes, because the winner differs from host to host.
+/// The wisdom is saved into the text file and loaded by the other processes
+/// of the same host. The shapes are timed outside the lock, so the
+/// concurrent misses of the same shape may time it more than once
+class Planner
+{
+public:
+    /// @brief What the planner does with the shape without the plan
+    enum class Mode
+    {
+        // picks FourRussians without timing anything
+        Estimate,
+        // times the candidates and records the fastest one
+        Measure
+    };
+
+    /// @brief The recorded winner of the shape
+    struct Plan
+    {
+        EliminationEngine engine;
+        // the best time of the whole solve with the engine
+        double seconds;
+    };
+
+    // the timed solves of every candidate, the best one is kept
+    static constexpr int repeats = 3;
+
+    /// @brief Planner constructor
+    /// @param planMode What is done with the shapes without the plan
+    explicit Planner(Mode planMode = Mode::Measure);
+
+    /// @brief Returns the engine of the shape, times the candidates first
+    /// if the shape has no plan for this host and the mode is Measure
+    /// @param y The number of the rows of the box
+    /// @param x The number of the columns of the box
+    EliminationEngine engineFor(uint32_t y, uint32_t x);
+
+    /// @brief Times the candidates of the shape even if it has the plan
+    /// and records the fastest one, the wisdom file is updated
+    /// @param y The number of the rows of the box
+    /// @param x The number of the columns of the box
+    /// @return the new plan of the shape
+    Plan measure(uint32_t y, uint32_t x);
+
+    /// @brief Returns the plan of the shape for this host, std::nullopt
+    /// if it has none
+    std::optional<Plan> find(uint32_t y, uint32_t x) const;
+
+    /// @brief Sets what is done with the shapes without the plan
+    void setMode(Mode planMode);
+
+    /// @brief Loads the wisdom file if it exists and saves the wisdom into it
+    /// after every new plan. The empty path disables the saving
+    void setWisdomFile(std::filesystem::path path);
+
+    /// @brief Adds the plans of the wisdom file replacing the known ones.
+    /// The plans of the other hosts are kept for the saving, the malformed
+    /// lines and the unknown engines are skipped
+    /// @throws std::runtime_error if the file can't be read
+    void load(const std::filesystem::path &path);
+
+    /// @brief Writes the plans of all the hosts into the wisdom file.
+    /// The file is written next to the path and renamed over it
+    /// @throws std::runtime_error if the file can't be written
+    void save(const std::filesystem::path &path) const;
+
+    /// @brief Returns the number of the plans of all the hosts
+    std::size_t size() const;
+
+    /// @brief Removes all the plans, the wisdom file is kept
+    void clear();
+
+    /// @brief Returns the key of the host the plans are recorded for,
+    /// e.g. avx2/l2:2048k/l3:32768k/t8. The hardware part is computed
+    /// once, the key is rebuilt only when the shared pool is reconfigured
+    static const std::string &hostKey();
+
+    /// @brief Returns the name of the engine in the wisdom file,
+    /// e.g. four_russians
+    static const char *engineName(EliminationEngine engine);
+
+    /// @brief Returns the engines timed by the planner, the expected
+    /// fastest first. Parallel is timed if the shared pool has more than
+    /// one thread, OutOfCore is left out as it's for the memory only
+    static std::vector<EliminationEngine> candidates();
+
+    /// @brief Returns the planner used by BoxHack for EliminationEngine::Auto
+    static Planner &shared();
+
+private:
+    using Key = std::tuple<std::string, uint32_t, uint32_t>;
+
+    mutable std::mutex mutex;
+    Mode mode;
+    // the plans of all the hosts, ordered so the file is stable
+    std::map<Key, Plan> plans;
+    std::filesystem::path wisdomFile;
+
+    /// @brief Times the candidates on the random unlockable state
+    static Plan time(uint32_t y, uint32_t x);
+
+    /// @brief Records the plan and saves the wisdom file if it's set
+    void record(const Key &key, const Plan &plan);
+
+    /// @brief Writes the wisdom file. The mutex is expected to be locked
+    void write(const std::filesystem::path &path) const;
+};
+} // namespace SecureBoxHack
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef ReusableHack_h
+#define ReusableHack_h
+
+#include "Factorization.h"
+#include "FactorizationCache.h"
+#include "types.h"
+#include <memory>
+#include <span>
+
+namespace SecureBoxHack
+{
+/// @brief Long-lived solver making no heap allocations in the steady state.
+///
+/// The shapes up to fixed::shapeLimit are solved by the compile-time
+/// tables, the rest by the factorization of the shape taken from the cache.
+/// The packed state and the solution rows live in the workspace of the
+/// calling thread, which only grows and refers to the factorization of
+/// the last shape, so the repeated solves of the same shape neither
+/// allocate nor lock the cache. The reference is weak, i.e. the cache
+/// budget and its eviction still apply to the factorization. The toggles
+/// are written into the caller's sequence, whose capacity is reused as
+/// well. The solver is stateless otherwise and may be shared between
+/// the threads
+class ReusableHack
+{
+public:
+    /// @brief The per-thread memory of the solves
+    struct Workspace
+    {
+        // the packed state and the solution of the current shape,
+        // the rows are as wide as the largest shape solved so far
+        BitMatrix rows{2, 0};
+        // the factorization of the last shape solved through the cache,
+        // it's looked up again once the cache has evicted it
+        std::weak_ptr<const Factorization> factorization{};
+    };
+
+    /// @brief ReusableHack constructor
+    /// @param cache The cache of the factorizations of the large shapes
+    explicit ReusableHack(
+        FactorizationCache &cache = FactorizationCache::shared());
+
+    /// @brief Finds the toggles unlocking the packed state
+    /// @param packedState The row-major bitmap of the state, see
+    /// helpers::packState()
+    /// @param height The number of the rows of the box
+    /// @param width The number of the columns of the box
+    /// @param toggles Receives the (y, x) coordinates of the toggles.
+    /// It's cleared first and left empty if the state can't be unlocked
+    /// @return false if the state can't be unlocked
+    bool solve(std::span<const uint64_t> packedState,
+               uint32_t height,
+               uint32_t width,
+               ToggleSequence &toggles) const;
+
+    /// @brief Finds the toggles unlocking the state. The state is packed
+    /// straight into the workspace
+    /// @param state The state of the box, e.g. SecureBox::getState()
+    /// @param toggles Receives the (y, x) coordinates of the toggles
+    /// @return false if the state can't be unlocked
+    bool solve(const BoolMatrix &state, ToggleSequence &toggles) const;
+
+    /// @brief Returns the workspace of the calling thread
+    static Workspace &workspace();
+
+private:
+    FactorizationCache &factorizations;
+
+    /// @brief Solves the state packed into the first row of the workspace
+    bool solvePacked(Workspace &space,
+                     uint32_t height,
+                     uint32_t width,
+                     ToggleSequence &toggles) const;
+
+    /// @brief Returns the workspace of the calling thread with the rows
+    /// holding at least the bits
+    static Workspace &reserve(std::size_t bits);
+};
+} // namespace SecureBoxHack
+
+#endif
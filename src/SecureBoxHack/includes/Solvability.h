@@ -0,0 +1,40 @@
+#ifndef Solvability_h
+#define Solvability_h
+
+#include "types.h"
+#include <span>
+
+namespace SecureBoxHack
+{
+/// @brief Solvability oracle of the box states.
+///
+/// The toggle of the cell (i, j) flips all the x cells of the row i and
+/// a single cell of every other row, so for the odd x it flips the parities
+/// of all the rows together and keeps them equal or different. The same
+/// holds for the columns and the odd y. The unlocked box has all the
+/// parities equal to 0, so these invariants are necessary, and the closed
+/// form solution of StructuredHack shows they are sufficient:
+///     the odd x requires all the row parities to be equal
+///     the odd y requires all the column parities to be equal
+///     any state of the even dimensions can be unlocked
+/// The check takes O(1) for the even dimensions and O(y * (x / 64 + 1))
+/// otherwise, instead of the elimination finding the inconsistent equation
+namespace solvability
+{
+/// @brief Checks whether the packed state can be unlocked
+/// @param packedState The row-major bitmap of the state, see
+/// helpers::packState(). At least (height * width + 63) / 64 words long
+/// @param height The number of the rows of the box
+/// @param width The number of the columns of the box
+/// @return false if no toggle sequence unlocks the state
+bool isSolvable(std::span<const uint64_t> packedState,
+                uint32_t height,
+                uint32_t width);
+
+/// @brief Checks whether the state can be unlocked
+/// @param state The state of the box, e.g. SecureBox::getState()
+bool isSolvable(const BoolMatrix &state);
+} // namespace solvability
+} // namespace SecureBoxHack
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef StreamSolver_h
+#define StreamSolver_h
+
+#include "BoxHack.h"
+#include "types.h"
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace SecureBoxHack
+{
+namespace stream
+{
+/// @brief The box read from the stream
+struct BoxInput
+{
+    uint32_t height = 0;
+    uint32_t width = 0;
+    // the row-major bitmap of the state, see helpers::packState()
+    std::vector<uint64_t> packed{};
+};
+
+/// @brief The throughput and the latencies of the stream. The latency
+/// of the box is measured from its read to its write
+struct StreamStats
+{
+    std::size_t boxes = 0;
+    std::size_t unsolvable = 0;
+    std::chrono::duration<double> elapsed{};
+    std::chrono::duration<double> p50{}, p90{}, p99{}, max{};
+};
+
+/// @brief Parses the box of the text format. The line holds the height,
+/// the width and the hexadecimal words of the packed state separated
+/// by the spaces, e.g. "3 3 1ff"
+/// @param line The line to be parsed
+/// @return the box, std::nullopt for the empty and the "#" comment lines
+/// @throw std::invalid_argument if the line is malformed
+std::optional<BoxInput> parseBox(const std::string &line);
+
+/// @brief Formats the result of the text format: the index of the box,
+/// the number of the toggles and the "y,x" toggles, or the index
+/// followed by "locked" if the box can't be unlocked
+std::string formatResult(std::size_t index,
+                         bool solvable,
+                         const ToggleSequence &toggles);
+
+/// @brief Formats the box of the text format, see parseBox()
+std::string formatBox(const BoxInput &box);
+
+/// @brief Pipelined solver of the stream of the boxes.
+///
+/// The reading, the solving and the writing overlap: the reader thread
+/// fills the ring of the slots, the workers solve the filled slots in any
+/// order and the calling thread writes the solved slots in the input order.
+/// The reader waits for the writer when all the slots are in flight,
+/// so the memory is bounded by the ring whatever the length of the stream
+class StreamSolver
+{
+public:
+    /// @brief Returns the next box, std::nullopt at the end of the stream.
+    /// Called by the reader thread only
+    using Reader = std::function<std::optional<BoxInput>()>;
+    /// @brief Receives the index of the box, whether it can be unlocked
+    /// and the toggles. Called by the calling thread in the input order
+    using Writer =
+        std::function<void(std::size_t, bool, const ToggleSequence &)>;
+
+    /// @brief StreamSolver constructor
+    /// @param threads The number of the solver threads, zero for
+    /// the hardware concurrency
+    /// @param inFlight The number of the boxes read but not written yet
+    /// @param engine The elimination of the boxes too large for
+    /// the compile-time solvers, see FixedShapeHack
+    StreamSolver(std::size_t threads,
+                 std::size_t inFlight,
+                 EliminationEngine engine = EliminationEngine::FourRussians);
+
+    /// @brief Solves the boxes until the end of the stream. The exception
+    /// of the reader, the solver or the writer stops the stream and is
+    /// rethrown
+    /// @return the statistics of the stream
+    StreamStats run(const Reader &read, const Writer &write) const;
+
+private:
+    const std::size_t workers;
+    const std::size_t window;
+    const EliminationEngine engine;
+};
+} // namespace stream
+} // namespace SecureBoxHack
+
+#endif
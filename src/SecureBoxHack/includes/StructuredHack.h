@@ -0,0 +1,65 @@
+#ifndef StructuredHack_h
+#define StructuredHack_h
+
+#include "DynamicBitset.h"
+#include "types.h"
+
+namespace SecureBoxHack
+{
+/// @brief Helper class unlocking the SecureBox without the Gauss matrix.
+///
+/// A toggle of the cell (i, j) flips the whole row i and the whole column j,
+/// so the cell (i, j) of the final state only depends on the toggle count
+/// in the row i (R), in the column j (C) and on the cell itself (t):
+///     s(i, j) = R(i) ^ C(j) ^ t(i, j)
+/// Summing this equation over the rows and the columns of the box gives
+/// the equations for the row parities r(i) and the column parities c(j)
+/// of the lock state and the parity T of the whole toggle set:
+///     r(i) = (x + 1) * R(i) ^ T
+///     c(j) = (y + 1) * C(j) ^ T
+/// which are solved in closed form depending on the dimensions parity.
+/// The whole solution takes O(y * x) time and memory.
+class StructuredHack
+{
+public:
+    /// @brief StructuredHack constructor
+    /// @param initialState The initial state of the box
+    StructuredHack(const BoolMatrix &initialState);
+
+    /// @brief Hacks the SecureBox and returns the vector of tupples
+    /// of the toggles that should be applied in order to unlock it
+    /// @return vector of tupples representing (y, x) coordinates for toggle.
+    /// The vector is empty if the state can't be unlocked
+    ToggleSequence getUnlockSequence();
+
+    /// @brief Checks whether the initial state can be unlocked at all.
+    /// If one of the box dimensions is odd, the toggles can't change
+    /// the parities of the lines along it independently, so all of them
+    /// have to be equal
+    /// @return true if the unlock sequence exists
+    bool isSolvable() const;
+
+private:
+    // SecureBox initial lock state. Stored by value, so the hack may outlive
+    // the temporary returned by SecureBox::getState()
+    const BoolMatrix state;
+    // SecureBox dimentions
+    const std::size_t y, x;
+    // parities of the locked cells in every row and every column
+    DynamicBitset rowParity, colParity;
+    // parities of the toggles in every row and every column of the solution
+    DynamicBitset rowToggles, colToggles;
+    // parity of the total toggles count
+    bool totalToggles;
+    bool solvable;
+
+    /// @brief Fills the rowParity and colParity of the initial state
+    void computeParities();
+
+    /// @brief Solves the parity equations filling the totalToggles,
+    /// rowToggles and colToggles values
+    void solveParities();
+};
+} // namespace SecureBoxHack
+
+#endif
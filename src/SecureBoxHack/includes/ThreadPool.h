@@ -0,0 +1,72 @@
+#ifndef ThreadPool_h
+#define ThreadPool_h
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SecureBoxHack
+{
+/// @brief Persistent pool of the worker threads.
+/// The threads are created once and wait for the tasks, so running
+/// a task doesn't pay for the threads creation
+class ThreadPool
+{
+public:
+    /// @brief Task executed by every participant of the pool.
+    /// Receives the zero-based participant index and the participants count
+    using Task = std::function<void(std::size_t, std::size_t)>;
+
+    /// @brief ThreadPool constructor
+    /// @param threads The number of the participants including the thread
+    /// calling run(). Zero stands for the hardware concurrency
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /// @brief Returns the number of the participants
+    /// including the thread calling run()
+    std::size_t size() const;
+
+    /// @brief Runs the task on every worker and on the calling thread.
+    /// Returns when all the participants are done. The concurrent calls
+    /// are serialized
+    /// @param task The task to be executed
+    void run(const Task &task);
+
+    /// @brief Returns the pool shared by the solvers
+    static ThreadPool &shared();
+
+    /// @brief Recreates the shared pool with the new threads count.
+    /// Must not be called while the shared pool runs a task
+    /// @param threads The number of the participants, zero for
+    /// the hardware concurrency
+    static void configureShared(std::size_t threads);
+
+private:
+    std::vector<std::thread> workers;
+    // serializes the run() calls
+    std::mutex runMutex;
+    // guards the fields below
+    std::mutex mutex;
+    std::condition_variable wakeUp, done;
+    const Task *task;
+    // incremented for every new task, so the workers see it only once
+    std::size_t generation;
+    std::size_t pending;
+    bool stopping;
+
+    /// @brief The worker thread loop
+    /// @param index The participant index of the worker
+    void workerLoop(std::size_t index);
+
+    static std::unique_ptr<ThreadPool> &sharedPool();
+};
+} // namespace SecureBoxHack
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef helpers_h
 #define helpers_h
 
+#include "BitMatrix.h"
 #include "DynamicBitset.h"
+#include "types.h"
 #include <bitset>
 #include <chrono>
 #include <concepts>
@@ -19,7 +21,9 @@ enum class LogLevel
     DEBUG
 };
 inline LogLevel logLevel = LogLevel::FATAL;
-inline auto lastMessageTimestamp = std::chrono::steady_clock::now();
+// every thread measures the time since its own last message
+inline thread_local auto lastMessageTimestamp =
+    std::chrono::steady_clock::now();
 
 /// @brief Logs the time in milliseconds elapsed since the last call to the
 /// logTimestamp() function or since the launch if no calls were made
@@ -30,6 +34,16 @@ void logTimestamp(LogLevel level = LogLevel::INFO);
 /// @param level custom log level. Defaults to INFO
 void logMessage(std::string message = "", LogLevel level = LogLevel::INFO);
 
+/// @brief Formats and prints the log message the printf way.
+/// The level is checked before the formatting, so the filtered out
+/// messages cost a single comparison
+/// @param level The log level of the message
+/// @param format The printf format of the message
+#if defined(__GNUC__)
+__attribute__((format(printf, 2, 3)))
+#endif
+void logFormat(LogLevel level, const char *format, ...);
+
 /// @brief Prints the std::vector in the output stream
 /// @tparam V - the value_type of the vector
 /// @param os output stream
@@ -53,6 +67,17 @@ inline std::ostream &operator<<(std::ostream &os, const DynamicBitset &bs)
     return os;
 }
 
+/// @brief Prints the BitMatrix row in the output stream
+/// @param os output stream
+/// @param row the row to be printed in the stream
+/// @return the reference to the @os param
+inline std::ostream &operator<<(std::ostream &os, ConstBitRow row)
+{
+    for (std::size_t i = 0; i < row.size(); i++)
+        os << row.test(i);
+    return os;
+}
+
 /// @brief Prints the matrix in the output stream.
 /// The log level required for the matrix output is DEBUG.
 /// The log level required for the message output is INFO.
@@ -82,6 +107,25 @@ void logMatrix(const M &m, std::string message = "")
 /// @return tuple with the {y, x} matrix coordinates
 std::tuple<uint32_t, uint32_t> toCartesianCoordinates(std::size_t i,
                                                       std::size_t x);
+
+/// @brief Returns the number of the columns of the state, 0 for the state
+/// without the rows
+std::size_t stateWidth(const BoolMatrix &state);
+
+/// @brief Packs the state into the row-major bitmap, the cell (i, j) is
+/// the bit i * x + j. Every word is assembled in the register and stored
+/// once instead of setting the bits one by one
+/// @param state The state of the box
+/// @return the words of the bitmap, the bits past the cells are zero
+std::vector<uint64_t> packState(const BoolMatrix &state);
+
+/// @brief Sets the bits of the cells flipped by the toggle of the cell,
+/// i.e. the whole row and the whole column of the cell
+/// @param row The row receiving the flat indices of the flipped cells
+/// @param i The flat index of the toggled cell
+/// @param y the number of the rows in the matrix
+/// @param x the number of the columns in the matrix
+void fillToggleRow(BitRow row, std::size_t i, std::size_t y, std::size_t x);
 } // namespace helpers
 } // namespace SecureBoxHack
 
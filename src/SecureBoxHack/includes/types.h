@@ -1,13 +1,17 @@
 #ifndef types_h
 #define types_h
 
+#include "BitMatrix.h"
 #include "DynamicBitset.h"
+#include <tuple>
 #include <vector>
 
 namespace SecureBoxHack
 {
 using BoolMatrix = std::vector<std::vector<bool>>;
-using GaussMatrix = std::vector<DynamicBitset>;
+using GaussMatrix = BitMatrix;
+// the list of the (y, x) coordinates to be toggled
+using ToggleSequence = std::vector<std::tuple<uint32_t, uint32_t>>;
 } // namespace SecureBoxHack
 
 #endif
@@ -5,20 +5,162 @@
 //  Created by Denys on 07.01.2025.
 //
 
+#include "Archive.h"
+#include "AsyncSolver.h"
+#include "BatchHack.h"
+#include "BitKernels.h"
 #include "BoxHack.h"
+#include "BoxState.h"
+#include "Cancellation.h"
+#include "FactorizationCache.h"
+#include "FactorizationStore.h"
+#include "FixedShapeHack.h"
+#include "FourRussians.h"
+#include "IncrementalHack.h"
+#include "Instrumentation.h"
+#include "LanczosHack.h"
+#include "MinimumToggles.h"
+#include "NaiveElimination.h"
+#include "OutOfCoreElimination.h"
+#include "Planner.h"
+#include "ReusableHack.h"
 #include "SecureBox.h"
+#include "Solvability.h"
+#include "StreamSolver.h"
+#include "StructuredHack.h"
+#include "ThreadPool.h"
 #include "helpers.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <coroutine>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <gtest/gtest.h>
+#include <latch>
+#include <mutex>
+#include <new>
+#include <numeric>
 #include <random>
 #include <ranges>
+#include <thread>
 #include <time.h>
 
 using namespace SecureBoxHack;
 
 std::mt19937 rng(static_cast<uint32_t>(time(0)));
 
-GTEST_TEST(SecureBoxTests, TestsUnder10)
+// the heap allocations made by the thread, counted by the replaced
+// global operator new
+thread_local std::size_t heapAllocations = 0;
+
+void *operator new(std::size_t size)
+{
+    heapAllocations++;
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    heapAllocations++;
+    const auto align = static_cast<std::size_t>(alignment);
+    if (void *memory = std::aligned_alloc(
+            align, std::max(align, (size + align - 1) / align * align)))
+        return memory;
+    throw std::bad_alloc();
+}
+
+// kept out of line, so GCC doesn't match the free() against the operator
+// new the deletes are inlined into
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void release(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept
+{
+    release(memory);
+}
+
+/// @brief Applies the toggles to the state the same way SecureBox does
+/// @return true if the state is unlocked after the toggles
+bool unlocks(const BoolMatrix &state, const ToggleSequence &toggles)
+{
+    BoxState box(state);
+    box.apply(toggles);
+    return !box.isLocked();
+}
+
+/// @brief Generates the random state which may be not unlockable
+BoolMatrix randomState(uint32_t y, uint32_t x)
+{
+    BoolMatrix state(y, std::vector<bool>(x));
+    for (auto &row : state)
+        for (std::size_t j = 0; j < x; j++)
+            row[j] = rng() % 2;
+    return state;
+}
+
+class SecureBoxTests : public testing::TestWithParam<EliminationEngine>
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        // more threads than the cores to stress the barriers
+        ThreadPool::configureShared(4);
+    }
+
+    // a few pivots per panel to get many panels on the small boxes
+    const elimination::OutOfCoreOptions panels{{}, 64 << 10};
+};
+
+INSTANTIATE_TEST_SUITE_P(
+    Engines,
+    SecureBoxTests,
+    testing::Values(EliminationEngine::Naive,
+                    EliminationEngine::FourRussians,
+                    EliminationEngine::Parallel,
+                    EliminationEngine::OutOfCore,
+                    EliminationEngine::Auto),
+    [](const testing::TestParamInfo<EliminationEngine> &param) {
+        switch (param.param)
+        {
+        case EliminationEngine::Naive:
+            return "Naive";
+        case EliminationEngine::FourRussians:
+            return "FourRussians";
+        case EliminationEngine::Parallel:
+            return "Parallel";
+        case EliminationEngine::OutOfCore:
+            return "OutOfCore";
+        case EliminationEngine::Auto:
+            return "Auto";
+        }
+        return "Unknown";
+    });
+
+TEST_P(SecureBoxTests, TestsUnder10)
 {
     for (int i = 0; i < 200; i++)
     {
@@ -30,7 +172,7 @@ GTEST_TEST(SecureBoxTests, TestsUnder10)
                                 [](const auto val) { return !val; }))
             continue;
 
-        BoxHack hack(state);
+        BoxHack hack(state, GetParam(), false, panels);
         auto toggleSeq = hack.getUnlockSequence();
 
         for (auto [posY, posX] : toggleSeq)
@@ -43,7 +185,22 @@ GTEST_TEST(SecureBoxTests, TestsUnder10)
     }
 }
 
-GTEST_TEST(SecureBoxTests, SquareMatrix10_20)
+TEST_P(SecureBoxTests, ArbitraryStates)
+{
+    for (int i = 0; i < 300; i++)
+    {
+        auto state = randomState(static_cast<uint32_t>(rng() % 9 + 1),
+                                 static_cast<uint32_t>(rng() % 9 + 1));
+
+        BoxHack hack(state, GetParam(), false, panels);
+        // the rank-deficient systems are solved only for the consistent
+        // right-hand side
+        EXPECT_EQ(unlocks(state, hack.getUnlockSequence()),
+                  StructuredHack(state).isSolvable());
+    }
+}
+
+TEST_P(SecureBoxTests, SquareMatrix10_20)
 {
     for (int i = 0; i < 200; i++)
     {
@@ -55,7 +212,7 @@ GTEST_TEST(SecureBoxTests, SquareMatrix10_20)
                                 [](const auto val) { return !val; }))
             continue;
 
-        BoxHack hack(state);
+        BoxHack hack(state, GetParam(), false, panels);
         auto toggleSeq = hack.getUnlockSequence();
 
         for (auto [posY, posX] : toggleSeq)
@@ -68,9 +225,1551 @@ GTEST_TEST(SecureBoxTests, SquareMatrix10_20)
     }
 }
 
+TEST_P(SecureBoxTests, MinimizedToggles)
+{
+    for (int i = 0; i < 20; i++)
+    {
+        // the odd sizes have the free unknowns, the large ones
+        // fall back to the greedy search
+        const auto y = static_cast<uint32_t>(rng() % 10 * 2 + 1);
+        const auto x = static_cast<uint32_t>(rng() % 10 * 2 + 1);
+        SecureBox box(y, x);
+
+        const auto plain = BoxHack(box.getState(), GetParam(), false, panels)
+                               .getUnlockSequence();
+        const auto minimized = BoxHack(box.getState(), GetParam(), true, panels)
+                                   .getUnlockSequence();
+        EXPECT_LE(minimized.size(), plain.size());
+
+        for (auto [posY, posX] : minimized)
+            box.toggle(posY, posX);
+        EXPECT_FALSE(box.isLocked());
+    }
+}
+
+TEST_P(SecureBoxTests, PackedState)
+{
+    for (int i = 0; i < 20; i++)
+    {
+        const auto y = static_cast<uint32_t>(rng() % 20 + 1);
+        const auto x = static_cast<uint32_t>(rng() % 20 + 1);
+        SecureBox box(y, x);
+
+        const auto packed = helpers::packState(box.getState());
+        ASSERT_EQ(packed.size(), (std::size_t{y} * x + 63) / 64);
+        for (std::size_t c = 0; c < std::size_t{y} * x; c++)
+            EXPECT_EQ(packed[c / 64] >> (c % 64) & 1,
+                      box.getState()[c / x][c % x]);
+
+        // the temporary state isn't referenced after the construction
+        BoxHack fromMatrix(box.getState(), GetParam(), false, panels);
+        BoxHack fromPacked(packed, y, x, GetParam(), false, panels);
+        const auto toggles = fromPacked.getUnlockSequence();
+        EXPECT_EQ(toggles, fromMatrix.getUnlockSequence());
+
+        for (auto [posY, posX] : toggles)
+            box.toggle(posY, posX);
+        EXPECT_FALSE(box.isLocked());
+    }
+
+    const std::vector<uint64_t> tooShort(1);
+    EXPECT_THROW(BoxHack(tooShort, 9, 8, GetParam(), false, panels),
+                 std::invalid_argument);
+}
+
+GTEST_TEST(StructuredHackTests, TestsUnder20)
+{
+    for (int i = 0; i < 200; i++)
+    {
+        SecureBox box(static_cast<uint32_t>(rng() % 20 + 1),
+                      static_cast<uint32_t>(rng() % 20 + 1));
+
+        StructuredHack hack(box.getState());
+        EXPECT_TRUE(hack.isSolvable());
+
+        for (auto [posY, posX] : hack.getUnlockSequence())
+            box.toggle(posY, posX);
+
+        EXPECT_FALSE(box.isLocked());
+    }
+}
+
+GTEST_TEST(StructuredHackTests, UnsolvableStates)
+{
+    // a single locked cell can't be unlocked if any dimension is odd
+    for (auto [y, x] :
+         {std::tuple{3u, 3u}, std::tuple{2u, 3u}, std::tuple{3u, 2u}})
+    {
+        BoolMatrix state(y, std::vector<bool>(x, false));
+        state[0][0] = true;
+
+        StructuredHack hack(state);
+        EXPECT_FALSE(hack.isSolvable());
+        EXPECT_TRUE(hack.getUnlockSequence().empty());
+    }
+
+    // but it's always possible for the even dimensions
+    BoolMatrix state(4, std::vector<bool>(4, false));
+    state[0][0] = true;
+    StructuredHack hack(state);
+    EXPECT_TRUE(hack.isSolvable());
+    EXPECT_EQ(hack.getUnlockSequence().size(), 7u);
+}
+
+GTEST_TEST(StructuredHackTests, LargeBox)
+{
+    for (auto [y, x] : {std::tuple{200u, 300u}, std::tuple{301u, 201u}})
+    {
+        SecureBox box(y, x);
+
+        StructuredHack hack(box.getState());
+        for (auto [posY, posX] : hack.getUnlockSequence())
+            box.toggle(posY, posX);
+
+        EXPECT_FALSE(box.isLocked());
+    }
+}
+
+GTEST_TEST(SolvabilityTests, MatchesStructuredHack)
+{
+    for (int i = 0; i < 300; i++)
+    {
+        // the rows wider than a word and crossing the word boundaries
+        const auto y = static_cast<uint32_t>(rng() % 9 + 1);
+        const auto x = static_cast<uint32_t>(rng() % 150 + 1);
+        auto state = randomState(y, x);
+        if (i % 3 == 0)
+            state = SecureBox(y, x).getState();
+
+        const bool expected = StructuredHack(state).isSolvable();
+        EXPECT_EQ(solvability::isSolvable(state), expected);
+        EXPECT_EQ(solvability::isSolvable(helpers::packState(state), y, x),
+                  expected);
+    }
+
+    // the single locked cell breaks the invariants of the odd dimension
+    BoolMatrix single(3, std::vector<bool>(4));
+    single[1][2] = true;
+    EXPECT_FALSE(solvability::isSolvable(single));
+    single[0][0] = single[2][3] = true;
+    EXPECT_FALSE(solvability::isSolvable(single));
+    EXPECT_TRUE(solvability::isSolvable(BoolMatrix{}));
+}
+
+GTEST_TEST(SolvabilityTests, EarlyReject)
+{
+    BoolMatrix state(101, std::vector<bool>(101));
+    state[50][50] = true;
+    instrumentation::reset();
+
+    // the unsolvable state isn't eliminated
+    BoxHack hack(state, EliminationEngine::Naive);
+    EXPECT_FALSE(hack.isSolvable());
+    EXPECT_TRUE(hack.getUnlockSequence().empty());
+    EXPECT_FALSE(hack.isSolvable());
+
+    if (!instrumentation::enabled)
+        return;
+    using instrumentation::Counter;
+    using instrumentation::Phase;
+    const auto stats = instrumentation::snapshot();
+    EXPECT_EQ(stats.counter(Counter::EarlyRejects), 1u);
+    EXPECT_EQ(stats.counter(Counter::Pivots), 0u);
+    EXPECT_EQ(stats.phase(Phase::Elimination).count, 0u);
+}
+
+GTEST_TEST(IncrementalHackTests, FollowsFlips)
+{
+    for (int i = 0; i < 50; i++)
+    {
+        const auto y = static_cast<uint32_t>(rng() % 20 + 1);
+        const auto x = static_cast<uint32_t>(rng() % 20 + 1);
+        BoolMatrix state = randomState(y, x);
+        IncrementalHack hack(state);
+        for (int k = 0; k < 20; k++)
+        {
+            if (k % 2)
+            {
+                // a few cells at once as the packed changes
+                std::vector<uint64_t> changes((y * x + 63) / 64);
+                for (int f = 0; f < 3; f++)
+                {
+                    const auto posY = static_cast<uint32_t>(rng() % y);
+                    const auto posX = static_cast<uint32_t>(rng() % x);
+                    state[posY][posX] = !state[posY][posX];
+                    const std::size_t cell = std::size_t{posY} * x + posX;
+                    changes[cell / 64] ^= uint64_t{1} << (cell % 64);
+                }
+                hack.flip(changes);
+            }
+            else
+            {
+                const auto posY = static_cast<uint32_t>(rng() % y);
+                const auto posX = static_cast<uint32_t>(rng() % x);
+                state[posY][posX] = !state[posY][posX];
+                hack.flip(posY, posX);
+            }
+
+            StructuredHack expected(state);
+            ASSERT_EQ(hack.isSolvable(), expected.isSolvable());
+            const auto toggles = hack.getUnlockSequence();
+            EXPECT_EQ(toggles, expected.getUnlockSequence());
+            EXPECT_EQ(unlocks(state, toggles), hack.isSolvable());
+        }
+        for (uint32_t posY = 0; posY < y; posY++)
+            for (uint32_t posX = 0; posX < x; posX++)
+                ASSERT_EQ(hack.test(posY, posX), state[posY][posX]);
+    }
+
+    // the repeated flips cancel each other
+    IncrementalHack hack(4, 6);
+    hack.flip({{1, 2}, {3, 5}, {1, 2}});
+    EXPECT_TRUE(hack.test(3, 5));
+    EXPECT_FALSE(hack.test(1, 2));
+    EXPECT_EQ(hack.getUnlockSequence().size(), 9u);
+    hack.flip(3, 5);
+    EXPECT_TRUE(hack.getUnlockSequence().empty());
+
+    IncrementalHack empty(BoolMatrix{});
+    EXPECT_TRUE(empty.isSolvable());
+    EXPECT_TRUE(empty.getUnlockSequence().empty());
+}
+
+GTEST_TEST(OutOfCoreTests, MatchesInMemory)
+{
+    for (auto [y, x] : {std::tuple{7u, 9u}, std::tuple{12u, 12u},
+                        std::tuple{15u, 21u}})
+    {
+        const std::size_t n = std::size_t{y} * x;
+        // the solution of the unlockable state doesn't depend on the engine
+        auto state = SecureBox(y, x).getState();
+        GaussMatrix inMemory(n, n + 1);
+        GaussMatrix onDisk(n, n + 1, std::filesystem::temp_directory_path());
+        for (std::size_t i = 0; i < n; i++)
+        {
+            helpers::fillToggleRow(inMemory[i], i, y, x);
+            helpers::fillToggleRow(onDisk[i], i, y, x);
+            inMemory[i].set(n, state[i / x][i % x]);
+            onDisk[i].set(n, state[i / x][i % x]);
+        }
+
+        elimination::echelonFourRussians(inMemory);
+        // every pivot takes its row and a quarter of a 16-row table,
+        // so the budget gives the panels of 8 pivots
+        const std::size_t rowBytes = onDisk.rowStride() * sizeof(uint64_t);
+        const auto stats =
+            elimination::echelonOutOfCore(onDisk, 8 * 5 * rowBytes);
+        EXPECT_GE(stats.panels, (n + 7) / 8);
+        EXPECT_GT(stats.bytesRead, 0u);
+        EXPECT_GT(stats.bytesWritten, 0u);
+
+        // both forms have the pivot of the column i in the row i
+        for (std::size_t i = 0; i < n; i++)
+            EXPECT_EQ(inMemory[i].test(i), onDisk[i].test(i));
+        EXPECT_EQ(BoxHack(state, EliminationEngine::OutOfCore)
+                      .getUnlockSequence(),
+                  BoxHack(state, EliminationEngine::FourRussians)
+                      .getUnlockSequence());
+    }
+}
+
+GTEST_TEST(OutOfCoreTests, InvalidTemporaryDirectory)
+{
+    const char *previous = std::getenv("TMPDIR");
+    const std::string saved = previous ? previous : "";
+    setenv("TMPDIR", "/nonexistent/secret_box", 1);
+
+    // only the scratch matrix resolves the temporary directory
+    const auto state = SecureBox(5, 6).getState();
+    EXPECT_NO_THROW(BoxHack(state).getUnlockSequence());
+    EXPECT_THROW(BoxHack(state, EliminationEngine::OutOfCore),
+                 std::filesystem::filesystem_error);
+
+    // the explicit directory doesn't depend on TMPDIR
+    const elimination::OutOfCoreOptions options{"/tmp", 64 << 10};
+    EXPECT_NO_THROW(BoxHack(state, EliminationEngine::OutOfCore, false, options)
+                        .getUnlockSequence());
+
+    if (previous)
+        setenv("TMPDIR", saved.c_str(), 1);
+    else
+        unsetenv("TMPDIR");
+}
+
+GTEST_TEST(NaiveEliminationTests, ColumnsMatchRows)
+{
+    std::mt19937_64 wordRng(rng());
+    // the toggle matrices and the random ones crossing the word boundaries
+    for (const std::size_t n : {9u, 35u, 64u, 65u, 130u, 200u})
+        for (const bool toggles : {true, false})
+        {
+            const auto y = static_cast<uint32_t>(n % 7 ? n % 7 : 1);
+            const auto x = static_cast<uint32_t>(n / y);
+            const std::size_t rows = toggles ? std::size_t{y} * x : n;
+            GaussMatrix byRows(rows, rows + 1), byColumns(rows, rows + 1);
+            for (std::size_t i = 0; i < rows; i++)
+            {
+                if (toggles)
+                    helpers::fillToggleRow(byRows[i], i, y, x);
+                else
+                    // sparse rows leave some columns without the pivot
+                    for (std::size_t j = 0; j <= rows; j++)
+                        byRows[i].set(j, wordRng() % 5 == 0);
+                byRows[i].set(rows, wordRng() % 2);
+                byColumns[i].assign(byRows[i]);
+            }
+
+            elimination::ColumnStrip strip(rows);
+            strip.load(byRows, 0);
+            for (std::size_t c = 0; c < std::min<std::size_t>(rows, 64); c++)
+                for (std::size_t r = 0; r < rows; r++)
+                    ASSERT_EQ(strip.column(c).test(r), byRows[r].test(c));
+
+            elimination::echelonNaive(byRows, elimination::PivotSearch::Rows);
+            elimination::echelonNaive(byColumns,
+                                      elimination::PivotSearch::Columns);
+            for (std::size_t i = 0; i < rows; i++)
+                for (std::size_t j = 0; j <= rows; j++)
+                    ASSERT_EQ(byRows[i].test(j), byColumns[i].test(j))
+                        << "n " << rows << " row " << i << " column " << j;
+        }
+}
+
+// the tables are built by the compiler
+static_assert(fixed::FixedHack<4, 6>::tables.checkCount == 0);
+static_assert(fixed::FixedHack<3, 5>::tables.checkCount == 6);
+
+GTEST_TEST(FixedShapeTests, SpecializedShapes)
+{
+    for (uint32_t y = 1; y <= fixed::shapeLimit; y++)
+        for (uint32_t x = 1; x <= fixed::shapeLimit; x++)
+        {
+            ASSERT_TRUE(FixedShapeHack::isSpecialized(y, x));
+            for (int i = 0; i < 4; i++)
+            {
+                auto state = i % 2 ? randomState(y, x)
+                                   : SecureBox(y, x).getState();
+                auto toggleSeq = FixedShapeHack(state).getUnlockSequence();
+                auto expected =
+                    BoxHack(state, EliminationEngine::FourRussians)
+                        .getUnlockSequence();
+
+                if (unlocks(state, expected))
+                    EXPECT_TRUE(unlocks(state, toggleSeq)) << y << "x" << x;
+                else
+                    EXPECT_TRUE(toggleSeq.empty()) << y << "x" << x;
+            }
+        }
+}
+
+GTEST_TEST(FixedShapeTests, Fallback)
+{
+    EXPECT_FALSE(FixedShapeHack::isSpecialized(fixed::shapeLimit + 1, 2));
+    EXPECT_FALSE(FixedShapeHack::isSpecialized(0, 2));
+
+    auto state = SecureBox(fixed::shapeLimit + 3, 17).getState();
+    auto toggleSeq =
+        FixedShapeHack(state, EliminationEngine::FourRussians)
+            .getUnlockSequence();
+    EXPECT_TRUE(unlocks(state, toggleSeq));
+
+    // the state without the rows falls back to BoxHack
+    FixedShapeHack empty(BoolMatrix{});
+    EXPECT_TRUE(empty.getUnlockSequence().empty());
+    EXPECT_TRUE(empty.isSolvable());
+}
+
+GTEST_TEST(StreamSolverTests, TextFormat)
+{
+    auto box = stream::parseBox("3 3 1ff");
+    ASSERT_TRUE(box);
+    EXPECT_EQ(box->height, 3u);
+    EXPECT_EQ(box->width, 3u);
+    EXPECT_EQ(box->packed, std::vector<uint64_t>{0x1ff});
+    EXPECT_EQ(stream::formatBox(*box), "3 3 1ff");
+
+    box = stream::parseBox("9 8 ffffffffffffffff 1");
+    ASSERT_TRUE(box);
+    EXPECT_EQ(box->packed, (std::vector<uint64_t>{~uint64_t{0}, 1}));
+
+    EXPECT_FALSE(stream::parseBox(""));
+    EXPECT_FALSE(stream::parseBox("  # comment"));
+    EXPECT_THROW(stream::parseBox("0 3 0"), std::invalid_argument);
+    EXPECT_THROW(stream::parseBox("3 3"), std::invalid_argument);
+    EXPECT_THROW(stream::parseBox("3 3 3ff"), std::invalid_argument);
+    EXPECT_THROW(stream::parseBox("3 3 1fz"), std::invalid_argument);
+
+    EXPECT_EQ(stream::formatResult(4, true, {{0, 1}, {2, 3}}), "4 2 0,1 2,3");
+    EXPECT_EQ(stream::formatResult(5, false, {{0, 1}}), "5 locked");
+}
+
+GTEST_TEST(StreamSolverTests, InOrderBounded)
+{
+    constexpr std::size_t count = 300, window = 8;
+    // the fixed shapes, the fallback shapes and the random states
+    // which may be locked
+    std::vector<BoolMatrix> states;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const auto y = static_cast<uint32_t>(i % 3 ? rng() % 8 + 2 : 20);
+        const auto x = static_cast<uint32_t>(rng() % 20 + 2);
+        states.push_back(i % 4 ? SecureBox(y, x).getState()
+                               : randomState(y, x));
+    }
+
+    std::size_t reads = 0, writes = 0, maxInFlight = 0;
+    std::mutex mutex;
+    stream::StreamSolver solver(4, window);
+    const auto stats = solver.run(
+        [&]() -> std::optional<stream::BoxInput> {
+            std::lock_guard lock(mutex);
+            if (reads == count)
+                return std::nullopt;
+            maxInFlight = std::max(maxInFlight, ++reads - writes);
+            const auto &state = states[reads - 1];
+            return stream::BoxInput{static_cast<uint32_t>(state.size()),
+                                    static_cast<uint32_t>(state[0].size()),
+                                    helpers::packState(state)};
+        },
+        [&](std::size_t index, bool solvable, const ToggleSequence &toggles) {
+            {
+                std::lock_guard lock(mutex);
+                ASSERT_EQ(index, writes++);
+            }
+            const auto &state = states[index];
+            if (solvable)
+                EXPECT_TRUE(unlocks(state, toggles)) << index;
+            else
+                EXPECT_FALSE(StructuredHack(state).isSolvable()) << index;
+        });
+
+    EXPECT_EQ(stats.boxes, count);
+    EXPECT_LE(maxInFlight, window);
+    EXPECT_LE(stats.p50, stats.p99);
+    EXPECT_LE(stats.p99, stats.max);
+}
+
+GTEST_TEST(StreamSolverTests, ReaderError)
+{
+    std::size_t reads = 0;
+    stream::StreamSolver solver(2, 4);
+    EXPECT_THROW(solver.run(
+                     [&]() -> std::optional<stream::BoxInput> {
+                         if (++reads == 10)
+                             return stream::parseBox("3 3 x");
+                         return stream::parseBox("3 3 1ff");
+                     },
+                     [](std::size_t, bool, const ToggleSequence &) {}),
+                 std::invalid_argument);
+}
+
+GTEST_TEST(BatchHackTests, ArbitraryStates)
+{
+    for (int i = 0; i < 20; i++)
+    {
+        const auto y = static_cast<uint32_t>(rng() % 9 + 1);
+        const auto x = static_cast<uint32_t>(rng() % 9 + 1);
+        // more states than a single pass holds
+        std::vector<BoolMatrix> states;
+        for (std::size_t j = 0; j < BatchHack::batchWidth + 40; j++)
+            states.push_back(randomState(y, x));
+
+        BatchHack hack(states);
+        const auto sequences = hack.getUnlockSequences();
+        ASSERT_EQ(sequences.size(), states.size());
+        for (std::size_t j = 0; j < states.size(); j++)
+        {
+            const bool solvable = StructuredHack(states[j]).isSolvable();
+            EXPECT_EQ(hack.isSolvable(j), solvable);
+            EXPECT_EQ(unlocks(states[j], sequences[j]), solvable);
+        }
+    }
+}
+
+GTEST_TEST(BatchHackTests, ShapeMismatch)
+{
+    std::vector<BoolMatrix> states{randomState(3, 4), randomState(4, 3)};
+    EXPECT_THROW(BatchHack{states}, std::invalid_argument);
+}
+
+GTEST_TEST(BatchHackTests, TemporaryStates)
+{
+    // the hack keeps the states passed as the temporary
+    const auto state = randomState(5, 6);
+    BatchHack hack({state, state});
+    const auto sequences = hack.getUnlockSequences();
+    ASSERT_EQ(sequences.size(), 2u);
+    EXPECT_EQ(sequences[0], sequences[1]);
+    EXPECT_EQ(unlocks(state, sequences[0]), hack.isSolvable(0));
+
+    // the state without the rows has no columns
+    EXPECT_THROW((BatchHack{{BoolMatrix{}, randomState(1, 1)}}),
+                 std::invalid_argument);
+    BatchHack empty({BoolMatrix{}});
+    EXPECT_EQ(empty.getUnlockSequences(), std::vector<ToggleSequence>(1));
+    EXPECT_TRUE(empty.isSolvable(0));
+
+    BoxHack box(BoolMatrix{});
+    EXPECT_TRUE(box.getUnlockSequence().empty());
+}
+
+GTEST_TEST(FactorizationTests, ArbitraryStates)
+{
+    for (int i = 0; i < 50; i++)
+    {
+        const auto y = static_cast<uint32_t>(rng() % 9 + 1);
+        const auto x = static_cast<uint32_t>(rng() % 9 + 1);
+        Factorization factorization(y, x);
+        EXPECT_EQ(factorization.rank() + factorization.nullSpace().size(),
+                  std::size_t{y} * x);
+
+        for (int j = 0; j < 10; j++)
+        {
+            auto state = randomState(y, x);
+            EXPECT_EQ(unlocks(state, factorization.getUnlockSequence(state)),
+                      StructuredHack(state).isSolvable());
+        }
+    }
+}
+
+GTEST_TEST(FactorizationTests, NullSpace)
+{
+    // the odd dimensions leave y + x - 2 free toggles
+    Factorization factorization(3, 5);
+    EXPECT_EQ(factorization.rank(), 9u);
+
+    BoolMatrix state(3, std::vector<bool>(5, false));
+    for (std::size_t k = 0; k < factorization.nullSpace().size(); k++)
+    {
+        ToggleSequence toggles;
+        for (std::size_t i = 0; i < 15; i++)
+            if (factorization.nullSpace()[k].test(i))
+                toggles.push_back(helpers::toCartesianCoordinates(i, 5));
+        EXPECT_FALSE(toggles.empty());
+        EXPECT_TRUE(unlocks(state, toggles));
+    }
+}
+
+GTEST_TEST(MinimumTogglesTests, Exhaustive)
+{
+    // the odd boxes have y + x - 2 free toggles, small enough to compare
+    // with the brute force over all the toggle sets
+    for (auto [y, x] : {std::tuple{3u, 3u}, std::tuple{3u, 5u}})
+    {
+        Factorization factorization(y, x);
+        const std::size_t n = std::size_t{y} * x;
+        for (int i = 0; i < 5; i++)
+        {
+            auto state = randomState(y, x);
+            const auto toggles = factorization.getUnlockSequence(state, true);
+            if (!StructuredHack(state).isSolvable())
+                continue;
+            EXPECT_TRUE(unlocks(state, toggles));
+
+            std::size_t best = n + 1;
+            for (std::size_t set = 0; set < (std::size_t{1} << n); set++)
+            {
+                ToggleSequence candidate;
+                for (std::size_t c = 0; c < n; c++)
+                    if (set >> c & 1)
+                        candidate.push_back(
+                            helpers::toCartesianCoordinates(c, x));
+                if (candidate.size() < best && unlocks(state, candidate))
+                    best = candidate.size();
+            }
+            EXPECT_EQ(toggles.size(), best);
+        }
+    }
+}
+
+GTEST_TEST(FactorizationCacheTests, LruEviction)
+{
+    const std::size_t shapeBytes = Factorization(8, 8).memoryUsage();
+    FactorizationCache cache(shapeBytes * 2);
+
+    auto first = cache.get(8, 8);
+    EXPECT_EQ(cache.get(8, 8), first);
+    cache.get(4, 16);
+    EXPECT_EQ(cache.size(), 2u);
+
+    // the use of 8x8 makes 4x16 the least recently used
+    cache.get(8, 8);
+    cache.get(16, 4);
+    EXPECT_TRUE(cache.contains(8, 8));
+    EXPECT_FALSE(cache.contains(4, 16));
+    EXPECT_TRUE(cache.contains(16, 4));
+    EXPECT_LE(cache.memoryUsage(), cache.budget());
+
+    cache.setBudget(shapeBytes);
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_TRUE(cache.contains(16, 4));
+
+    // the evicted factorization is still usable by its owner
+    auto state = randomState(8, 8);
+    EXPECT_EQ(unlocks(state, first->getUnlockSequence(state)),
+              StructuredHack(state).isSolvable());
+}
+
+GTEST_TEST(FactorizationCacheTests, ConcurrentSolves)
+{
+    FactorizationCache cache;
+    std::vector<std::thread> threads;
+    std::vector<int> failures(4, 0);
+
+    for (std::size_t t = 0; t < failures.size(); t++)
+        threads.emplace_back([&, t] {
+            std::mt19937 threadRng(static_cast<uint32_t>(t));
+            for (int i = 0; i < 50; i++)
+            {
+                const auto y = static_cast<uint32_t>(threadRng() % 4 + 3);
+                SecureBox box(y, y + 1);
+                for (auto [posY, posX] :
+                     cache.get(y, y + 1)->getUnlockSequence(box.getState()))
+                    box.toggle(posY, posX);
+                failures[t] += box.isLocked();
+            }
+        });
+    for (auto &thread : threads)
+        thread.join();
+
+    EXPECT_EQ(failures, std::vector<int>(4, 0));
+    EXPECT_EQ(cache.size(), 4u);
+}
+
+/// @brief Checks whether the matrices have the same bits
+bool sameBits(const BitMatrix &a, const BitMatrix &b)
+{
+    if (a.size() != b.size() || a.columns() != b.columns())
+        return false;
+    for (std::size_t i = 0; i < a.size(); i++)
+        for (std::size_t j = 0; j < a.columns(); j++)
+            if (a[i].test(j) != b[i].test(j))
+                return false;
+    return true;
+}
+
+GTEST_TEST(FactorizationStoreTests, SaveLoad)
+{
+    const auto directory = std::filesystem::temp_directory_path() /
+                           ("secret_box_store_" + std::to_string(rng()));
+    std::filesystem::create_directories(directory);
+    const auto path = directory / store::fileName(5, 7);
+
+    Factorization factorization(5, 7);
+    store::save(factorization, path);
+    auto loaded = store::load(path);
+    EXPECT_EQ(loaded->height(), 5u);
+    EXPECT_EQ(loaded->width(), 7u);
+    EXPECT_EQ(loaded->rank(), factorization.rank());
+    for (int i = 0; i < 20; i++)
+    {
+        auto state = randomState(5, 7);
+        EXPECT_EQ(loaded->getUnlockSequence(state),
+                  factorization.getUnlockSequence(state));
+    }
+
+    EXPECT_TRUE(sameBits(loaded->pseudoInverse(),
+                         factorization.pseudoInverse()));
+    EXPECT_TRUE(sameBits(loaded->nullSpace(), factorization.nullSpace()));
+
+    // the cache maps the stored shape instead of building it
+    FactorizationCache cache;
+    cache.setStoreDirectory(directory);
+    instrumentation::reset();
+    auto cached = cache.get(5, 7);
+    EXPECT_TRUE(sameBits(cached->pseudoInverse(),
+                         factorization.pseudoInverse()));
+    EXPECT_TRUE(sameBits(cached->nullSpace(), factorization.nullSpace()));
+    using instrumentation::Counter;
+    if (instrumentation::enabled)
+    {
+        const auto stats = instrumentation::snapshot();
+        EXPECT_EQ(stats.counter(Counter::StoreLoads), 1u);
+    }
+
+    // flipping a single bit of the contents breaks the checksum
+    {
+        std::fstream file(path,
+                          std::ios::binary | std::ios::in | std::ios::out);
+        file.seekg(100);
+        const auto byte = static_cast<char>(file.get() ^ 0x10);
+        file.seekp(100);
+        file.put(byte);
+    }
+    EXPECT_THROW(store::load(path), std::runtime_error);
+    EXPECT_NO_THROW(store::load(path, false));
+
+    // the corrupted file is ignored by the cache
+    cache.clear();
+    auto state = randomState(5, 7);
+    EXPECT_EQ(cache.get(5, 7)->getUnlockSequence(state),
+              factorization.getUnlockSequence(state));
+    if (instrumentation::enabled)
+    {
+        const auto stats = instrumentation::snapshot();
+        EXPECT_EQ(stats.counter(Counter::StoreLoads), 2u);
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+GTEST_TEST(PlannerTests, MeasuresOnce)
+{
+    Planner planner;
+    EXPECT_FALSE(planner.find(12, 14).has_value());
+
+    const auto engine = planner.engineFor(12, 14);
+    const auto candidates = Planner::candidates();
+    EXPECT_NE(std::find(candidates.begin(), candidates.end(), engine),
+              candidates.end());
+    const auto plan = planner.find(12, 14);
+    ASSERT_TRUE(plan.has_value());
+    EXPECT_EQ(plan->engine, engine);
+    EXPECT_GT(plan->seconds, 0.0);
+
+    // the planned shape isn't timed again
+    instrumentation::reset();
+    EXPECT_EQ(planner.engineFor(12, 14), engine);
+    if (instrumentation::enabled)
+    {
+        const auto stats = instrumentation::snapshot();
+        EXPECT_EQ(stats.counter(instrumentation::Counter::Solves), 0u);
+    }
+
+    // the estimate doesn't time anything
+    Planner estimate(Planner::Mode::Estimate);
+    EXPECT_EQ(estimate.engineFor(12, 14), EliminationEngine::FourRussians);
+    EXPECT_EQ(estimate.size(), 0u);
+}
+
+GTEST_TEST(PlannerTests, CallerStop)
+{
+    // the trials keep the cancelled token of the caller
+    Planner planner;
+    cancellation::StopCondition condition;
+    condition.token.cancel();
+    {
+        cancellation::Scope scope(condition);
+        EXPECT_THROW(planner.engineFor(12, 14), SolveStopped);
+    }
+    EXPECT_FALSE(planner.find(12, 14).has_value());
+    EXPECT_EQ(cancellation::installed(), nullptr);
+}
+
+GTEST_TEST(PlannerTests, Wisdom)
+{
+    const auto path = std::filesystem::temp_directory_path() /
+                      ("secret_box_wisdom_" + std::to_string(rng()));
+    {
+        std::ofstream file(path);
+        file << "# the plans of another host and the malformed lines\n"
+             << "otherhost 9 9 parallel 0.5\n"
+             << "otherhost 9 9\n"
+             << Planner::hostKey() << " 9 9 simd 0.1\n"
+             << Planner::hostKey() << " 8 8 naive 0.25\n";
+    }
+
+    Planner planner;
+    planner.setWisdomFile(path);
+    EXPECT_EQ(planner.size(), 2u);
+    EXPECT_FALSE(planner.find(9, 9).has_value());
+    // the loaded plan is used without timing
+    EXPECT_EQ(planner.engineFor(8, 8), EliminationEngine::Naive);
+    EXPECT_EQ(planner.find(8, 8)->seconds, 0.25);
+
+    // the new plan is saved with the plans of the other host
+    const auto plan = planner.measure(9, 9);
+    Planner loaded(Planner::Mode::Estimate);
+    loaded.load(path);
+    EXPECT_EQ(loaded.size(), 3u);
+    ASSERT_TRUE(loaded.find(9, 9).has_value());
+    EXPECT_EQ(loaded.find(9, 9)->engine, plan.engine);
+    EXPECT_EQ(loaded.engineFor(8, 8), EliminationEngine::Naive);
+
+    std::filesystem::remove(path);
+    EXPECT_THROW(loaded.load(path), std::runtime_error);
+}
+
+GTEST_TEST(PlannerTests, TrialsNotCounted)
+{
+    // the shape is planned by the solve
+    Planner::shared().clear();
+    const auto state = SecureBox(7, 9).getState();
+    instrumentation::reset();
+    EXPECT_TRUE(unlocks(
+        state, BoxHack(state, EliminationEngine::Auto).getUnlockSequence()));
+    EXPECT_TRUE(Planner::shared().find(7, 9).has_value());
+
+    if (!instrumentation::enabled)
+        return;
+    EXPECT_TRUE(instrumentation::recording());
+    using instrumentation::Counter;
+    using instrumentation::Phase;
+    const auto stats = instrumentation::snapshot();
+    EXPECT_EQ(stats.counter(Counter::Solves), 1u);
+    EXPECT_EQ(stats.phase(Phase::BuildGaussMatrix).count, 1u);
+    EXPECT_EQ(stats.phase(Phase::Elimination).count, 1u);
+}
+
+GTEST_TEST(PlannerTests, AutoOutOfCore)
+{
+    // the wisdom written by hand may choose OutOfCore
+    const auto path = std::filesystem::temp_directory_path() /
+                      ("secret_box_wisdom_" + std::to_string(rng()));
+    {
+        std::ofstream file(path);
+        file << Planner::hostKey() << " 6 6 out_of_core 0.1\n";
+    }
+    Planner::shared().load(path);
+    std::filesystem::remove(path);
+
+    const char *previous = std::getenv("TMPDIR");
+    const std::string saved = previous ? previous : "";
+    setenv("TMPDIR", "/nonexistent/secret_box", 1);
+
+    // Auto resolved to OutOfCore allocates the scratch matrix
+    const auto state = SecureBox(6, 6).getState();
+    EXPECT_THROW(BoxHack(state, EliminationEngine::Auto),
+                 std::filesystem::filesystem_error);
+    const elimination::OutOfCoreOptions options{"/tmp", 64 << 10};
+    EXPECT_TRUE(unlocks(
+        state,
+        BoxHack(state, EliminationEngine::Auto, false, options)
+            .getUnlockSequence()));
+
+    if (previous)
+        setenv("TMPDIR", saved.c_str(), 1);
+    else
+        unsetenv("TMPDIR");
+    Planner::shared().clear();
+}
+
+GTEST_TEST(ArchiveTests, RoundTrip)
+{
+    const auto path = std::filesystem::temp_directory_path() /
+                      ("secret_box_archive_" + std::to_string(rng()));
+    std::vector<BoolMatrix> states;
+    std::vector<ToggleSequence> solutions;
+    {
+        archive::Writer writer(path);
+        for (int i = 0; i < 60; i++)
+        {
+            const auto y = static_cast<uint32_t>(rng() % 30 + 1);
+            const auto x = static_cast<uint32_t>(rng() % 30 + 1);
+            if (i % 5 == 1)
+            {
+                // the sparse solution is stored as the deltas
+                const auto posY = static_cast<uint32_t>(rng() % y);
+                const auto posX = static_cast<uint32_t>(rng() % x);
+                BoxState box(y, x);
+                box.toggle(posY, posX);
+                states.push_back(box.getState());
+                solutions.push_back({{posY, posX}});
+                writer.add(y,
+                           x,
+                           helpers::packState(states.back()),
+                           true,
+                           solutions.back());
+                continue;
+            }
+            states.push_back(randomState(y, x));
+            BoxHack hack(states.back());
+            solutions.push_back(hack.getUnlockSequence());
+            const auto packed = helpers::packState(states.back());
+            if (i % 5 == 0)
+                writer.add(y, x, packed);
+            else
+                writer.add(y, x, packed, hack.isSolvable(), solutions.back());
+        }
+        // the toggles of the same cell cancel each other
+        writer.add(2,
+                   3,
+                   std::vector<uint64_t>{0},
+                   true,
+                   {{1, 2}, {0, 0}, {1, 2}});
+        EXPECT_EQ(writer.size(), 61u);
+        writer.close();
+    }
+
+    archive::Reader reader(path);
+    ASSERT_EQ(reader.size(), 61u);
+    std::size_t i = 0;
+    bool deltas = false, bitmap = false;
+    for (const auto &record : reader)
+    {
+        if (i == states.size())
+        {
+            EXPECT_EQ(record.toggles(), (ToggleSequence{{0, 0}}));
+            i++;
+            continue;
+        }
+        const auto &state = states[i];
+        ASSERT_EQ(record.height, state.size());
+        ASSERT_EQ(record.width, state[0].size());
+        EXPECT_TRUE(std::ranges::equal(record.state,
+                                       helpers::packState(state)));
+
+        auto toggles = solutions[i];
+        std::ranges::sort(toggles);
+        if (i % 5 == 0)
+            EXPECT_EQ(record.solution, archive::Solution::None);
+        else if (!record.isSolvable())
+            EXPECT_FALSE(StructuredHack(state).isSolvable());
+        else
+            EXPECT_EQ(record.toggles(), toggles) << i;
+        deltas |= record.solution == archive::Solution::Deltas;
+        bitmap |= record.solution == archive::Solution::Bitmap;
+        i++;
+    }
+    EXPECT_EQ(i, 61u);
+    EXPECT_TRUE(deltas);
+    EXPECT_TRUE(bitmap);
+
+    // the truncated record is reported by the iteration
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    archive::Reader truncated(path);
+    EXPECT_THROW(for ([[maybe_unused]] const auto &record : truncated){},
+                 std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+GTEST_TEST(ArchiveTests, BitmapPadding)
+{
+    const auto path = std::filesystem::temp_directory_path() /
+                      ("secret_box_archive_" + std::to_string(rng()));
+    {
+        archive::Writer writer(path, archive::Encoding::Bitmap);
+        BoxState box(3, 3);
+        box.toggle(1, 1);
+        writer.add(3, 3, helpers::packState(box.getState()), true, {{1, 1}});
+        writer.close();
+    }
+    {
+        archive::Reader reader(path);
+        EXPECT_EQ(reader.begin()->toggles(), (ToggleSequence{{1, 1}}));
+    }
+
+    // the toggle bitmap of the record follows the headers and the state
+    // word, the bit 9 is past the cells of the box
+    {
+        std::fstream file(path,
+                          std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(32 + 16 + 8 + 1);
+        file.put('\x02');
+    }
+    archive::Reader reader(path);
+    EXPECT_THROW(reader.begin()->toggles(), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+GTEST_TEST(ArchiveTests, Unpublished)
+{
+    const auto path = std::filesystem::temp_directory_path() /
+                      ("secret_box_archive_" + std::to_string(rng()));
+    {
+        archive::Writer writer(path);
+        writer.add(3, 3, helpers::packState(randomState(3, 3)));
+    }
+    EXPECT_FALSE(std::filesystem::exists(path));
+    EXPECT_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "not an archive, but long enough for the header";
+    }
+    EXPECT_THROW(archive::Reader{path}, std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+/// @brief The coroutine started eagerly and never awaited
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object()
+        {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+        void return_void()
+        {
+        }
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+};
+
+/// @brief Awaits the solve and records the order of the completions
+Detached solveInOrder(AsyncSolver &solver,
+                      BoolMatrix state,
+                      SolveOptions options,
+                      int id,
+                      std::mutex &mutex,
+                      std::vector<int> &order,
+                      std::promise<bool> done)
+{
+    const auto y = static_cast<uint32_t>(state.size());
+    const auto x = static_cast<uint32_t>(state[0].size());
+    const SolveResult result =
+        co_await solver.solve(helpers::packState(state), y, x, options);
+    {
+        std::lock_guard lock(mutex);
+        order.push_back(id);
+    }
+    done.set_value(unlocks(state, result.toggles));
+}
+
+/// @brief Occupies the thread of the executor resuming the coroutine
+/// until the release latch is counted down
+Detached occupyWorker(AsyncSolver &solver,
+                      std::latch &started,
+                      std::latch &release)
+{
+    // the single toggled cell
+    const std::vector<uint64_t> packed{1};
+    SolveOptions options;
+    options.priority = Priority::High;
+    co_await solver.solve(packed, 1, 1, options);
+    started.count_down();
+    release.wait();
+}
+
+GTEST_TEST(AsyncSolverTests, Futures)
+{
+    AsyncSolver solver(3);
+    std::vector<BoolMatrix> states;
+    std::vector<std::future<SolveResult>> results;
+    for (int i = 0; i < 100; i++)
+    {
+        states.push_back(randomState(static_cast<uint32_t>(rng() % 24 + 1),
+                                     static_cast<uint32_t>(rng() % 24 + 1)));
+        SolveOptions options;
+        options.minimizeToggles = i % 10 == 0;
+        results.push_back(solver.solveAsync(states.back(), options));
+    }
+
+    for (std::size_t i = 0; i < states.size(); i++)
+    {
+        const SolveResult result = results[i].get();
+        const bool solvable = StructuredHack(states[i]).isSolvable();
+        EXPECT_EQ(result.solvable, solvable);
+        EXPECT_EQ(unlocks(states[i], result.toggles), solvable);
+    }
+
+    const std::vector<uint64_t> tooShort(1);
+    EXPECT_THROW(solver.solveAsync(tooShort, 9, 8), std::invalid_argument);
+
+    const SolveResult empty = solver.solveAsync(BoolMatrix{}).get();
+    EXPECT_TRUE(empty.solvable);
+    EXPECT_TRUE(empty.toggles.empty());
+}
+
+GTEST_TEST(AsyncSolverTests, StopsElimination)
+{
+    // every engine checks the condition between the blocks of the pivots
+    for (auto engine : {EliminationEngine::Naive,
+                        EliminationEngine::FourRussians,
+                        EliminationEngine::Parallel,
+                        EliminationEngine::OutOfCore})
+    {
+        cancellation::StopCondition condition;
+        condition.token.cancel();
+        const cancellation::Scope scope(condition);
+        BoxHack hack(randomState(20, 20), engine);
+        EXPECT_THROW(hack.getUnlockSequence(), SolveStopped);
+    }
+    EXPECT_FALSE(cancellation::stopRequested());
+
+    {
+        cancellation::StopCondition condition;
+        condition.deadline = cancellation::Clock::now();
+        const cancellation::Scope scope(condition);
+        BoxHack hack(randomState(20, 20), EliminationEngine::Naive);
+        EXPECT_THROW(hack.getUnlockSequence(), SolveStopped);
+    }
+
+    // the single thread is occupied, so both solves stay queued until
+    // they are past the deadline and cancelled
+    AsyncSolver solver(1);
+    std::latch started(1), release(1);
+    occupyWorker(solver, started, release);
+    started.wait();
+
+    const auto state = helpers::packState(randomState(20, 20));
+    SolveOptions pastDeadline, cancellable;
+    pastDeadline.deadline = cancellation::Clock::now();
+    auto expired = solver.solveAsync(state, 20, 20, pastDeadline);
+    auto cancelled = solver.solveAsync(state, 20, 20, cancellable);
+    cancellable.token.cancel();
+    release.count_down();
+
+    try
+    {
+        expired.get();
+        ADD_FAILURE() << "The deadline is missed";
+    }
+    catch (const SolveStopped &stopped)
+    {
+        EXPECT_EQ(stopped.reason(), SolveStopped::Reason::DeadlineExceeded);
+    }
+    try
+    {
+        cancelled.get();
+        ADD_FAILURE() << "The solve isn't cancelled";
+    }
+    catch (const SolveStopped &stopped)
+    {
+        EXPECT_EQ(stopped.reason(), SolveStopped::Reason::Cancelled);
+    }
+}
+
+GTEST_TEST(AsyncSolverTests, Priorities)
+{
+    // the single thread is occupied, so the boxes are queued behind it
+    AsyncSolver solver(1);
+    std::latch started(1), release(1);
+    occupyWorker(solver, started, release);
+    started.wait();
+
+    std::mutex mutex;
+    std::vector<int> order;
+    std::vector<std::future<bool>> unlocked;
+    for (int id = 0; id < 6; id++)
+    {
+        SolveOptions options;
+        options.priority = id % 2 ? Priority::High : Priority::Low;
+        std::promise<bool> done;
+        unlocked.push_back(done.get_future());
+        SecureBox box(static_cast<uint32_t>(rng() % 10 + 1),
+                      static_cast<uint32_t>(rng() % 10 + 1));
+        solveInOrder(
+            solver, box.getState(), options, id, mutex, order, std::move(done));
+    }
+    release.count_down();
+
+    for (auto &done : unlocked)
+        EXPECT_TRUE(done.get());
+    EXPECT_EQ(order, (std::vector<int>{1, 3, 5, 0, 2, 4}));
+}
+
+GTEST_TEST(ReusableHackTests, ArbitraryStates)
+{
+    const ReusableHack solver;
+    ToggleSequence toggles;
+    for (int i = 0; i < 100; i++)
+    {
+        // both the compile-time and the factorized shapes
+        const auto y = static_cast<uint32_t>(rng() % 24 + 1);
+        const auto x = static_cast<uint32_t>(rng() % 24 + 1);
+        const auto state = randomState(y, x);
+
+        const bool solvable = StructuredHack(state).isSolvable();
+        EXPECT_EQ(solver.solve(state, toggles), solvable);
+        EXPECT_EQ(unlocks(state, toggles), solvable);
+
+        ToggleSequence fromPacked{{0, 0}};
+        EXPECT_EQ(solver.solve(helpers::packState(state), y, x, fromPacked),
+                  solvable);
+        EXPECT_EQ(fromPacked, toggles);
+    }
+
+    const std::vector<uint64_t> tooShort(1);
+    EXPECT_THROW(solver.solve(tooShort, 9, 8, toggles), std::invalid_argument);
+
+    EXPECT_TRUE(solver.solve(BoolMatrix{}, toggles));
+    EXPECT_TRUE(toggles.empty());
+}
+
+GTEST_TEST(ReusableHackTests, CacheBudgetApplies)
+{
+    FactorizationCache cache;
+    const ReusableHack solver(cache);
+    const auto state = SecureBox(20, 22).getState();
+    ToggleSequence toggles;
+    ASSERT_TRUE(solver.solve(state, toggles));
+    EXPECT_FALSE(ReusableHack::workspace().factorization.expired());
+
+    // the evicted factorization isn't kept alive by the workspace
+    cache.clear();
+    EXPECT_TRUE(ReusableHack::workspace().factorization.expired());
+    ToggleSequence again;
+    EXPECT_TRUE(solver.solve(state, again));
+    EXPECT_EQ(again, toggles);
+    EXPECT_TRUE(cache.contains(20, 22));
+}
+
+GTEST_TEST(ReusableHackTests, NoSteadyStateAllocations)
+{
+    const ReusableHack solver;
+    const std::vector<std::tuple<uint32_t, uint32_t>> shapes{
+        {24, 20}, {5, 7}, {3, 3}};
+    std::vector<std::vector<uint64_t>> states;
+    for (auto [y, x] : shapes)
+    {
+        SecureBox box(y, x);
+        states.push_back(helpers::packState(box.getState()));
+    }
+
+    const auto solveAll = [&](std::size_t &allocations, int &unlocked) {
+        ToggleSequence toggles;
+        toggles.reserve(24 * 20);
+        // the first round grows the workspace and fetches the factorization
+        for (std::size_t k = 0; k < shapes.size(); k++)
+            solver.solve(states[k],
+                         std::get<0>(shapes[k]),
+                         std::get<1>(shapes[k]),
+                         toggles);
+
+        const std::size_t before = heapAllocations;
+        for (std::size_t round = 0; round < 60; round++)
+        {
+            // the compile-time shapes are interleaved with the factorized
+            // one and don't replace its factorization in the workspace
+            const std::size_t k = round % shapes.size();
+            auto [y, x] = shapes[k];
+            unlocked += solver.solve(states[k], y, x, toggles);
+        }
+        allocations = heapAllocations - before;
+    };
+
+    std::size_t allocations = 1;
+    int unlocked = 0;
+    solveAll(allocations, unlocked);
+    EXPECT_EQ(allocations, 0u);
+    EXPECT_EQ(unlocked, 60);
+
+    // every thread has its own workspace
+    std::vector<std::size_t> threadAllocations(4, 1);
+    std::vector<int> threadUnlocked(4, 0);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < threadAllocations.size(); t++)
+        threads.emplace_back(solveAll,
+                             std::ref(threadAllocations[t]),
+                             std::ref(threadUnlocked[t]));
+    for (auto &thread : threads)
+        thread.join();
+    for (std::size_t t = 0; t < threadAllocations.size(); t++)
+    {
+        EXPECT_EQ(threadAllocations[t], 0u);
+        EXPECT_EQ(threadUnlocked[t], 60);
+    }
+}
+
+GTEST_TEST(LanczosHackTests, ArbitraryStates)
+{
+    for (int i = 0; i < 100; i++)
+    {
+        const auto y = static_cast<uint32_t>(rng() % 30 + 1);
+        const auto x = static_cast<uint32_t>(rng() % 30 + 1);
+        auto state = randomState(y, x);
+
+        LanczosHack hack(state, rng());
+        const bool unlocked = unlocks(state, hack.getUnlockSequence());
+        const bool solvable = StructuredHack(state).isSolvable();
+        EXPECT_EQ(unlocked, solvable) << y << "x" << x;
+        EXPECT_EQ(hack.outcome(), solvable ? lanczos::Outcome::Solved
+                                           : lanczos::Outcome::Unsolvable)
+            << y << "x" << x;
+    }
+}
+
+GTEST_TEST(LanczosHackTests, LargeBox)
+{
+    // the dense Gauss matrix of these boxes would take gigabytes
+    for (auto [y, x] : {std::tuple{300u, 400u}, std::tuple{301u, 201u}})
+    {
+        SecureBox box(y, x);
+
+        LanczosHack hack(box.getState());
+        for (auto [posY, posX] : hack.getUnlockSequence())
+            box.toggle(posY, posX);
+
+        EXPECT_FALSE(box.isLocked());
+    }
+}
+
+GTEST_TEST(LanczosHackTests, ApplyToggles)
+{
+    // the operator matches the toggle rows of the Gauss matrix
+    const std::size_t y = 5, x = 7;
+    BitMatrix m(y * x, y * x);
+    for (std::size_t i = 0; i < y * x; i++)
+        helpers::fillToggleRow(m[i], i, y, x);
+
+    lanczos::Block in(y * x), out(y * x);
+    for (auto &word : in)
+        word = (uint64_t{rng()} << 32) | rng();
+    LanczosHack::applyToggles(y, x, in, out);
+    for (std::size_t r = 0; r < y * x; r++)
+    {
+        uint64_t expected = 0;
+        for (std::size_t c = 0; c < y * x; c++)
+            if (m[r].test(c))
+                expected ^= in[c];
+        EXPECT_EQ(out[r], expected);
+    }
+}
+
+GTEST_TEST(BoxStateTests, MatchesSecureBox)
+{
+    for (int i = 0; i < 20; i++)
+    {
+        const auto y = static_cast<uint32_t>(rng() % 70 + 1);
+        const auto x = static_cast<uint32_t>(rng() % 70 + 1);
+        SecureBox box(y, x);
+        BoxState single(box.getState());
+        BoxState batch(box.getState());
+        EXPECT_EQ(single.getState(), box.getState());
+
+        ToggleSequence toggles;
+        for (std::size_t k = rng() % 200; k > 0; k--)
+            toggles.emplace_back(static_cast<uint32_t>(rng() % y),
+                                 static_cast<uint32_t>(rng() % x));
+        for (auto [posY, posX] : toggles)
+        {
+            box.toggle(posY, posX);
+            single.toggle(posY, posX);
+        }
+        batch.apply(toggles);
+
+        EXPECT_EQ(single.getState(), box.getState());
+        EXPECT_EQ(batch.getState(), box.getState());
+        EXPECT_EQ(batch.isLocked(), box.isLocked());
+    }
+
+    BoxState unlocked(3, 100);
+    EXPECT_FALSE(unlocked.isLocked());
+    unlocked.toggle(2, 99);
+    EXPECT_TRUE(unlocked.isLocked());
+    unlocked.apply({{2, 99}});
+    EXPECT_FALSE(unlocked.isLocked());
+}
+
+GTEST_TEST(BitKernelsTests, MatchScalar)
+{
+    using kernels::Word;
+    const auto tables = kernels::available();
+    const auto &scalar = *tables.front();
+    std::mt19937_64 wordRng(rng());
+
+    for (std::size_t n = 1; n < 40; n++)
+    {
+        std::vector<Word> a(n), b(n);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            // keep some zero words to exercise the skipping in the scan
+            a[i] = wordRng() % 3 ? 0 : wordRng();
+            b[i] = wordRng();
+        }
+
+        auto expected = a;
+        scalar.xorWords(expected.data(), b.data(), n);
+
+        for (const auto *table : tables)
+        {
+            SCOPED_TRACE(table->name);
+            auto actual = a;
+            table->xorWords(actual.data(), b.data(), n);
+            EXPECT_EQ(actual, expected);
+
+            EXPECT_EQ(table->andParity(a.data(), b.data(), n),
+                      scalar.andParity(a.data(), b.data(), n));
+
+            for (std::size_t from = 0; from <= n * 64; from += 7)
+                EXPECT_EQ(table->findFirstSet(a.data(), n, from),
+                          scalar.findFirstSet(a.data(), n, from));
+        }
+    }
+}
+
+GTEST_TEST(BitKernelsTests, Transpose64)
+{
+    using kernels::Word;
+    std::mt19937_64 wordRng(rng());
+    Word block[64], transposed[64];
+    for (auto &word : block)
+        word = wordRng();
+    std::copy(block, block + 64, transposed);
+
+    kernels::transpose64(transposed);
+    for (std::size_t r = 0; r < 64; r++)
+        for (std::size_t c = 0; c < 64; c++)
+            ASSERT_EQ(transposed[c] >> r & 1, block[r] >> c & 1);
+    kernels::transpose64(transposed);
+    EXPECT_TRUE(std::equal(block, block + 64, transposed));
+}
+
+GTEST_TEST(ThreadPoolTests, RunsOnEveryParticipant)
+{
+    ThreadPool pool(3);
+    ASSERT_EQ(pool.size(), 3u);
+
+    for (int i = 0; i < 100; i++)
+    {
+        std::vector<std::size_t> visits(pool.size(), 0);
+        pool.run([&](std::size_t worker, std::size_t workers) {
+            EXPECT_EQ(workers, 3u);
+            visits[worker]++;
+        });
+        EXPECT_EQ(visits, std::vector<std::size_t>(3, 1));
+    }
+}
+
+GTEST_TEST(InstrumentationTests, CountsSolve)
+{
+    if (!instrumentation::enabled)
+        GTEST_SKIP() << "The instrumentation is compiled out";
+
+    using instrumentation::Counter;
+    using instrumentation::Phase;
+    instrumentation::reset();
+    BoxHack(SecureBox(6, 8).getState()).getUnlockSequence();
+    const auto stats = instrumentation::snapshot();
+
+    EXPECT_EQ(stats.counter(Counter::Solves), 1u);
+    // the even boxes have the single solution
+    EXPECT_EQ(stats.counter(Counter::Pivots), 48u);
+    EXPECT_EQ(stats.counter(Counter::FreeVariables), 0u);
+    EXPECT_GT(stats.counter(Counter::RowXors), 0u);
+    EXPECT_EQ(stats.counter(Counter::WordsTouched),
+              stats.counter(Counter::RowXors) * 3 * BitMatrix::strideFor(49));
+    EXPECT_GT(stats.counter(Counter::BytesAllocated), 0u);
+
+    for (auto phase :
+         {Phase::BuildGaussMatrix, Phase::Elimination, Phase::BackSubstitution})
+    {
+        const auto &histogram = stats.phase(phase);
+        EXPECT_EQ(histogram.count, 1u);
+        EXPECT_EQ(std::accumulate(histogram.buckets.begin(),
+                                  histogram.buckets.end(),
+                                  uint64_t{0}),
+                  1u);
+    }
+    EXPECT_EQ(stats.phase(Phase::Minimization).count, 0u);
+}
+
+GTEST_TEST(InstrumentationTests, AggregatesThreads)
+{
+    if (!instrumentation::enabled)
+        GTEST_SKIP() << "The instrumentation is compiled out";
+
+    using instrumentation::Counter;
+    instrumentation::reset();
+    instrumentation::count(Counter::RowXors, 5);
+
+    // the counters of the exited threads are kept
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++)
+        threads.emplace_back(
+            [] { instrumentation::count(Counter::RowXors, 10); });
+    for (auto &thread : threads)
+        thread.join();
+    EXPECT_EQ(instrumentation::snapshot().counter(Counter::RowXors), 45u);
+
+    instrumentation::reset();
+    EXPECT_EQ(instrumentation::snapshot().counter(Counter::RowXors), 0u);
+}
+
+GTEST_TEST(InstrumentationTests, Export)
+{
+    using instrumentation::Histogram;
+    instrumentation::Snapshot stats;
+    stats.counters[static_cast<std::size_t>(
+        instrumentation::Counter::Solves)] = 2;
+    auto &elimination = stats.phases[static_cast<std::size_t>(
+        instrumentation::Phase::Elimination)];
+    // 0.5 and 3 microseconds
+    elimination.buckets[Histogram::bucketOf(500)]++;
+    elimination.buckets[Histogram::bucketOf(3000)]++;
+    elimination.count = 2;
+    elimination.sumNanoseconds = 3500;
+    EXPECT_EQ(Histogram::bucketOf(500), 0u);
+    EXPECT_EQ(Histogram::bucketOf(3000), 2u);
+
+    const auto json = instrumentation::toJson(stats);
+    EXPECT_NE(json.find("\"solves\":2"), std::string::npos);
+    EXPECT_NE(json.find("\"elimination\":{\"count\":2"), std::string::npos);
+
+    const auto text = instrumentation::toPrometheus(stats);
+    EXPECT_NE(text.find("secret_box_solves_total 2\n"), std::string::npos);
+    EXPECT_NE(text.find("secret_box_phase_seconds_bucket"
+                        "{phase=\"elimination\",le=\"2e-06\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("secret_box_phase_seconds_bucket"
+                        "{phase=\"elimination\",le=\"4e-06\"} 2\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("secret_box_phase_seconds_count"
+                        "{phase=\"elimination\"} 2\n"),
+              std::string::npos);
+}
+
+GTEST_TEST(BitMatrixTests, RowsLayout)
+{
+    BitMatrix m(5, 600);
+    EXPECT_EQ(m.size(), 5u);
+    EXPECT_EQ(m.columns(), 600u);
+    // the rows are padded to the whole cache lines
+    EXPECT_EQ(m.rowStride() % BitMatrix::lineWords, 0u);
+    for (std::size_t i = 0; i < m.size(); i++)
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(m.rowData(i)) %
+                      BitMatrix::alignment,
+                  0u);
+
+    m[1].set(0);
+    m[1].set(599);
+    m[3].set(70);
+    m.swapRows(1, 3);
+    EXPECT_TRUE(m[3].test(0));
+    EXPECT_TRUE(m[3].back());
+    EXPECT_TRUE(m[1].test(70));
+    EXPECT_FALSE(m[1].test(0));
+
+    m[3] ^= m[1];
+    EXPECT_EQ(m[3].findFirst(1), 70u);
+    EXPECT_TRUE(m[3].andParity(m[1]));
+
+    m[0].assign(m[3]);
+    EXPECT_TRUE(m[0].test(599));
+    m.reset();
+    EXPECT_EQ(m[0].findFirst(), m.columns());
+}
+
+GTEST_TEST(DynamicBitsetTests, Operations)
+{
+    DynamicBitset a(130), b(130);
+    a.set(3);
+    a.set(129);
+    b.set(129);
+    b.set(64);
+
+    EXPECT_EQ(a.findFirst(), 3u);
+    EXPECT_EQ(a.findFirst(4), 129u);
+    EXPECT_EQ(b.findFirst(65), 129u);
+    EXPECT_TRUE(a.andParity(b));
+
+    a ^= b;
+    EXPECT_TRUE(a.test(64));
+    EXPECT_FALSE(a.test(129));
+    EXPECT_TRUE(a.andParity(b));
+    b.set(3);
+    EXPECT_FALSE(a.andParity(b));
+    EXPECT_EQ(a.findFirst(65), a.size());
+
+    EXPECT_THROW(a ^= DynamicBitset(129), std::invalid_argument);
+}
+
 #ifdef BUILD_TYPE_RELEASE
 
-TEST(SecureBoxTests, TestsUnder30_50)
+TEST_P(SecureBoxTests, TestsUnder30_50)
 {
     for (int i = 0; i < 10; i++)
     {
@@ -82,7 +1781,7 @@ TEST(SecureBoxTests, TestsUnder30_50)
                                 [](const auto val) { return !val; }))
             continue;
 
-        BoxHack hack(state);
+        BoxHack hack(state, GetParam(), false, panels);
         auto toggleSeq = hack.getUnlockSequence();
 
         for (auto [posY, posX] : toggleSeq)
@@ -95,7 +1794,7 @@ TEST(SecureBoxTests, TestsUnder30_50)
     }
 }
 
-TEST(SecureBoxTests, TestsUnder50_100)
+TEST_P(SecureBoxTests, TestsUnder50_100)
 {
     for (int i = 0; i < 10; i++)
     {
@@ -107,7 +1806,7 @@ TEST(SecureBoxTests, TestsUnder50_100)
                                 [](const auto val) { return !val; }))
             continue;
 
-        BoxHack hack(state);
+        BoxHack hack(state, GetParam(), false, panels);
         auto toggleSeq = hack.getUnlockSequence();
 
         for (auto [posY, posX] : toggleSeq)